@@ -0,0 +1,511 @@
+//
+// AdviseIndexesCommand.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "CBLiteCommand.hh"
+#include "N1QLClauses.hh"
+#include "QueryPlan.hh"
+#include "TableWriter.hh"
+#include "FilePath.hh"
+#include "StringUtil.hh"
+#include "Stopwatch.hh"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <set>
+
+using namespace std;
+using namespace litecore;
+using namespace fleece;
+
+
+/** The `advise-indexes` command: finds the expressions in a workload of queries that make them
+    scan whole collections, proposes indexes on them, and measures each proposed index on a
+    scratch copy of the database. */
+class AdviseIndexesCommand : public CBLiteCommand {
+public:
+    AdviseIndexesCommand(CBLiteTool &parent)
+    :CBLiteCommand(parent)
+    { }
+
+
+    void usage() override {
+        writeUsageCommand("advise-indexes", true, "QUERYFILE");
+        cerr <<
+        "  Proposes indexes for a workload of N1QL queries, and measures them on a scratch copy\n"
+        "  of the database. The database itself is not changed.\n"
+        "    --runs N : Number of timed runs of each query [default: 5]\n"
+        "  " << it("QUERYFILE") << " : N1QL queries, including the 'SELECT', one per line.\n"
+        "              Blank lines and lines starting with '#' or '--' are skipped.\n";
+    }
+
+
+    void runSubcommand() override {
+        processFlags({
+            {"--runs", [&]{_runs = parseNextArg<unsigned>("number of runs", 1);}},
+        });
+        openDatabaseFromNextArg();
+        string path = nextArg("query file");
+        endOfArgs();
+
+        readQueries(path);
+        cout << "Read " << _queries.size() << " queries; " << _candidates.size()
+             << " candidate indexes\n";
+        if (_candidates.empty()) {
+            cout << "No query scans a whole collection; no indexes to propose.\n";
+            return;
+        }
+        measure();
+        report();
+    }
+
+
+private:
+    struct Query {
+        string          n1ql;
+        bool            fullScan = false;
+        double          baseline = 0;       // Median run time without any proposed index
+    };
+
+    struct Candidate {
+        C4CollectionSpec spec() const {
+            return {slice(collection), slice(scope)};
+        }
+
+        string          scope, collection;
+        vector<string>  expressions;
+        string          where;              // Makes it a partial index
+        string          unnestPath;         // Makes it an array index
+        set<size_t>     queries;            // Indexes of the queries it's proposed for
+        // Measurements:
+        bool            created = false;
+        double          buildTime = 0;
+        int64_t         size = 0;
+        map<size_t,double> speedups;        // Query index -> baseline time / time with index
+        set<size_t>     usedBy;             // Queries whose plans use the index
+
+        string expression() const       {return join(expressions, ", ");}
+        string kind() const {
+            return !unnestPath.empty() ? "array" : (!where.empty() ? "partial" : "value");
+        }
+        string key() const {
+            return scope + "." + collection + "|" + expression() + "|" + where + "|" + unnestPath;
+        }
+    };
+
+
+    static string join(const vector<string> &items, const char *separator) {
+        string result;
+        for (auto &item : items) {
+            if (!result.empty())
+                result += separator;
+            result += item;
+        }
+        return result;
+    }
+
+
+#pragma mark - PROPOSING INDEXES:
+
+
+    void readQueries(const string &path) {
+        ifstream in(path);
+        if (!in)
+            fail("Couldn't open " + path);
+        string line;
+        while (getline(in, line)) {
+            auto start = line.find_first_not_of(" \t\r");
+            if (start == string::npos || line[start] == '#' || line.compare(start, 2, "--") == 0)
+                continue;
+            line = line.substr(start);
+            while (!line.empty() && (isspace((unsigned char)line.back()) || line.back() == ';'))
+                line.pop_back();
+
+            C4Error error;
+            int errorPos;
+            c4::ref<C4Query> query = c4query_new2(_db, kC4N1QLQuery, slice(line), &errorPos, &error);
+            if (!query) {
+                errorOccurred("compiling query \"" + line + "\"", error);
+                continue;
+            }
+            size_t q = _queries.size();
+            QueryPlan plan = QueryPlan::parse(alloc_slice(c4query_explain(query)));
+            _queries.push_back({line, plan.hasFullScan()});
+            if (plan.hasFullScan())
+                proposeIndexes(q);
+        }
+        if (_queries.empty())
+            fail(path + " contains no valid queries");
+    }
+
+
+    // Finds the expressions in the query's WHERE, ORDER BY and JOIN clauses that an index could
+    // be used for, and adds candidate indexes on them.
+    void proposeIndexes(size_t q) {
+        auto clauses = N1QLClauses::parse(_queries[q].n1ql);
+        if (!clauses)
+            return;
+        auto [scope, collection, alias] = N1QLClauses::parseSource(clauses->from);
+        if (collection.empty())
+            return;
+
+        vector<string> equalities, ranges;
+        string discriminator, discriminatorExpr;   // An `expr = 'string'` term, for a partial index
+        for (auto &term : N1QLClauses::splitConjunction(clauses->where)) {
+            if (term.empty())
+                continue;
+            static const regex kAnySatisfies(R"(^(ANY|SOME|EVERY)\s+(\w+)\s+IN\s+(.+?)\s+SATISFIES\s+(.+)\s+END$)",
+                                             regex::icase);
+            smatch m;
+            if (regex_match(term, m, kAnySatisfies)) {
+                // `ANY v IN path SATISFIES v.prop = ... END` can use an array index on `prop`:
+                string var = m[2], path = stripAlias(m[3], alias), condition = m[4];
+                vector<string> props;
+                for (auto &inner : N1QLClauses::splitConjunction(condition)) {
+                    auto comparison = parseComparison(inner);
+                    if (comparison && hasPrefix(comparison->first, var + "."))
+                        props.push_back(comparison->first.substr(var.size() + 1));
+                }
+                if (!props.empty())
+                    addCandidate(q, {scope, collection, props, "", path});
+            } else if (auto comparison = parseComparison(term)) {
+                string expr = stripAlias(comparison->first, alias);
+                if (comparison->second) {
+                    equalities.push_back(expr);
+                    if (discriminator.empty() && regex_search(term, regex(R"(=\s*'[^']*'$)"))) {
+                        discriminator = stripAlias(term, alias);
+                        discriminatorExpr = expr;
+                    }
+                } else {
+                    ranges.push_back(expr);
+                }
+            }
+        }
+
+        // A composite index: equality terms first, then one range term, then the sort order.
+        vector<string> composite = equalities;
+        if (!ranges.empty())
+            composite.push_back(ranges[0]);
+        for (auto &term : clauses->orderBy) {
+            string expr = stripAlias(term.expression, alias);
+            if (isIndexable(expr))
+                composite.push_back(expr);
+        }
+        dedupe(composite);
+        if (!composite.empty())
+            addCandidate(q, {scope, collection, composite});
+
+        // The same without the discriminator, as a partial index limited to matching docs:
+        if (!discriminator.empty() && composite.size() > 1) {
+            vector<string> rest;
+            for (auto &expr : composite) {
+                if (expr != discriminatorExpr)
+                    rest.push_back(expr);
+            }
+            if (!rest.empty() && rest.size() < composite.size())
+                addCandidate(q, {scope, collection, rest, discriminator});
+        }
+
+        // Index the joined collections on the expressions they're joined by:
+        static const regex kJoin(R"(\bJOIN\s+(\S+)\s+(?:AS\s+)?(\w+)\s+ON\s+(.+?)(?=\s+(?:(?:LEFT|INNER|CROSS)\s+)?(?:OUTER\s+)?JOIN\b|$))",
+                                 regex::icase);
+        for (sregex_iterator i(clauses->from.begin(), clauses->from.end(), kJoin), end; i != end; ++i) {
+            auto [jScope, jCollection, jAlias] = N1QLClauses::parseSource((*i)[1].str() + " " + (*i)[2].str());
+            for (auto &term : N1QLClauses::splitConjunction((*i)[3])) {
+                static const regex kJoinTerm(R"(^(.+?)\s*==?\s*(.+)$)");
+                smatch m;
+                if (!regex_match(term, m, kJoinTerm))
+                    continue;
+                for (string side : {m[1].str(), m[2].str()}) {
+                    if (hasPrefix(side, jAlias + ".")) {
+                        string expr = stripAlias(side, jAlias);
+                        if (isIndexable(expr))
+                            addCandidate(q, {jScope, jCollection, {expr}});
+                    }
+                }
+            }
+        }
+    }
+
+
+    // If `term` compares an indexable expression to a constant or parameter, returns the
+    // expression, and whether the comparison is an equality.
+    static optional<pair<string,bool>> parseComparison(const string &term) {
+        static const regex kComparison(
+            R"(^(.+?)\s*(==|=|!=|<>|<=|>=|<|>|\s+NOT\s+LIKE\s+|\s+LIKE\s+|\s+NOT\s+IN\s+|\s+IN\s+|\s+BETWEEN\s+|\s+IS\s+)(.+)$)",
+            regex::icase);
+        smatch m;
+        if (!regex_match(term, m, kComparison))
+            return nullopt;
+        string left = m[1], op = m[2], right = m[3];
+        for (auto &c : op)
+            c = char(toupper(c));
+        bool equality = (op == "=" || op == "==" || op.find(" IN ") != string::npos
+                                   || op.find(" IS ") != string::npos);
+        if (op.find("NOT") != string::npos || op == "!=" || op == "<>")
+            return nullopt;     // Negations can't use an index well
+        if (isIndexable(left) && isConstant(right))
+            return pair(left, equality);
+        if (isIndexable(right) && isConstant(left) && op.find(' ') == string::npos)
+            return pair(right, equality);
+        return nullopt;
+    }
+
+
+    static bool isConstant(const string &expr) {
+        static const regex kConstant(R"(^('.*'|".*"|-?[\d.]+(e-?\d+)?|\$\w+|TRUE|FALSE|NULL|MISSING|\[.*\]|\(.*\)|.+ AND .+)$)",
+                                     regex::icase);
+        return regex_match(expr, kConstant);
+    }
+
+
+    static bool isIndexable(const string &expr) {
+        // Property paths and function calls on them, but not doc IDs, which are already indexed:
+        static const regex kMeta(R"(\bmeta\s*\()", regex::icase);
+        return !expr.empty() && !isConstant(expr) && !regex_search(expr, kMeta);
+    }
+
+
+    // Removes the `alias.` prefix from property paths, since index expressions are relative to
+    // the document.
+    static string stripAlias(const string &expr, const string &alias) {
+        if (alias.empty())
+            return expr;
+        regex prefix("(^|[^\\w.$`])`?" + alias + "`?\\.");
+        return regex_replace(expr, prefix, "$1");
+    }
+
+
+    static void dedupe(vector<string> &items) {
+        vector<string> result;
+        for (auto &item : items) {
+            if (find(result.begin(), result.end(), item) == result.end())
+                result.push_back(item);
+        }
+        items = std::move(result);
+    }
+
+
+    void addCandidate(size_t q, Candidate c) {
+        string key = c.key();
+        for (auto &existing : _candidates) {
+            if (existing.key() == key) {
+                existing.queries.insert(q);
+                return;
+            }
+        }
+        c.queries.insert(q);
+        _candidates.push_back(std::move(c));
+    }
+
+
+#pragma mark - MEASURING:
+
+
+    // Copies the database to the scratch directory, times the queries there, then creates each
+    // candidate index by itself and times the queries it was proposed for again.
+    void measure() {
+        uint64_t dbSize, blobsSize, nBlobs;
+        getDBSizes(dbSize, blobsSize, nBlobs);
+        FilePath dir = FilePath(scratchDirectory(dbSize + blobsSize), "").mkTempDir();
+        cout << "Copying database to " << dir.path() << " ...\n";
+        C4DatabaseConfig2 config = {slice(dir.path()), kC4DB_Create};
+        C4Error error;
+        alloc_slice srcPath = c4db_getPath(_db);
+        if (!c4db_copyNamed(srcPath, "advisor"_sl, &config, &error))
+            fail("copying database to scratch directory", error);
+        c4::ref<C4Database> scratch = c4db_openNamed("advisor"_sl, &config, &error);
+        if (!scratch)
+            fail("opening scratch copy of database", error);
+
+        try {
+            cout << "Timing queries without new indexes ...\n";
+            for (auto &query : _queries) {
+                if (query.fullScan)
+                    query.baseline = timeQuery(scratch, query.n1ql);
+            }
+
+            for (size_t n = 0; n < _candidates.size(); ++n) {
+                Candidate &c = _candidates[n];
+                string name = indexName(n);
+                cout << "Trying " << name << " on " << c.expression() << " ...\n";
+                C4Collection *coll = c4db_getCollection(scratch, c.spec(), &error);
+                if (!coll) {
+                    errorOccurred("getting collection " + c.scope + "." + c.collection, error);
+                    continue;
+                }
+                C4IndexOptions options = {};
+                if (!c.where.empty())
+                    options.where = c.where.c_str();
+                if (!c.unnestPath.empty())
+                    options.unnestPath = c.unnestPath.c_str();
+                C4IndexType type = c.unnestPath.empty() ? kC4ValueIndex : kC4ArrayIndex;
+
+                int64_t sizeBefore = databaseSize(dir);
+                Stopwatch st;
+                if (!c4coll_createIndex(coll, slice(name), slice(c.expression()), kC4N1QLQuery,
+                                        type, &options, &error)) {
+                    errorOccurred("creating index on " + c.expression(), error);
+                    continue;
+                }
+                c.created = true;
+                c.buildTime = st.elapsed();
+                c.size = databaseSize(dir) - sizeBefore;
+
+                for (size_t q : c.queries) {
+                    c4::ref<C4Query> query = c4query_new2(scratch, kC4N1QLQuery,
+                                                          slice(_queries[q].n1ql), nullptr, &error);
+                    if (!query)
+                        continue;
+                    string plan(alloc_slice(c4query_explain(query)));
+                    if (plan.find(name) != string::npos)
+                        c.usedBy.insert(q);
+                    double time = timeQuery(scratch, _queries[q].n1ql);
+                    c.speedups[q] = (time > 0) ? _queries[q].baseline / time : 0;
+                }
+
+                if (!c4coll_deleteIndex(coll, slice(name), &error))
+                    fail("deleting index " + name + " from scratch database", error);
+            }
+        } catch (...) {
+            deleteScratch(scratch, dir);
+            throw;
+        }
+        deleteScratch(scratch, dir);
+    }
+
+
+    // Returns the median time of `_runs` runs of a query.
+    double timeQuery(C4Database *db, const string &n1ql) {
+        C4Error error;
+        c4::ref<C4Query> query = c4query_new2(db, kC4N1QLQuery, slice(n1ql), nullptr, &error);
+        if (!query)
+            fail("compiling query \"" + n1ql + "\"", error);
+        vector<double> times;
+        for (unsigned i = 0; i < _runs; ++i) {
+            Stopwatch st;
+            c4::ref<C4QueryEnumerator> e = c4query_run(query, nullslice, &error);
+            if (!e)
+                fail("running query \"" + n1ql + "\"", error);
+            while (c4queryenum_next(e, &error))
+                ;
+            if (error.code)
+                fail("running query \"" + n1ql + "\"", error);
+            times.push_back(st.elapsed());
+        }
+        sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+
+    // The size of the database's SQLite files, including the WAL.
+    static int64_t databaseSize(const FilePath &dir) {
+        int64_t size = 0;
+        FilePath db = dir["advisor.cblite2/"];
+        for (const char *file : {"db.sqlite3", "db.sqlite3-wal"}) {
+            if (FilePath path = db[file]; path.exists())
+                size += path.dataSize();
+        }
+        return size;
+    }
+
+
+    static void deleteScratch(c4::ref<C4Database> &db, FilePath &dir) {
+        C4Error error;
+        if (!c4db_delete(db, &error))
+            cerr << "Warning: error deleting scratch database: " << c4error_descriptionStr(error) << "\n";
+        db = nullptr;
+        try {
+            dir.delRecursive();
+        } catch (...) { }
+    }
+
+
+    static string indexName(size_t n)     {return "advised_" + to_string(n + 1);}
+
+
+#pragma mark - REPORTING:
+
+
+    void report() {
+        cout << "\n" << bold("Queries:") << "\n";
+        for (size_t q = 0; q < _queries.size(); ++q) {
+            cout << stringprintf("  Q%-3zu ", q + 1);
+            if (_queries[q].fullScan)
+                cout << stringprintf("%9.3f ms  ", _queries[q].baseline * 1000);
+            else
+                cout << "   indexed    ";
+            cout << _queries[q].n1ql << "\n";
+        }
+
+        cout << "\n" << bold("Candidate indexes:") << "\n";
+        TableWriter table({"Name", "Kind", "Collection", "Expression", "Used by", "Speedup",
+                           "Size", "Build"});
+        for (size_t n = 0; n < _candidates.size(); ++n) {
+            Candidate &c = _candidates[n];
+            string expression = c.expression();
+            if (!c.unnestPath.empty())
+                expression = "UNNEST " + c.unnestPath + ": " + expression;
+            if (!c.where.empty())
+                expression += " WHERE " + c.where;
+            string usedBy, speedup;
+            for (size_t q : c.usedBy) {
+                usedBy += (usedBy.empty() ? "Q" : ", Q") + to_string(q + 1);
+                speedup += (speedup.empty() ? "" : ", ") + stringprintf("%.1fx", c.speedups[q]);
+            }
+            if (!c.created)
+                usedBy = "(failed)";
+            else if (c.usedBy.empty())
+                usedBy = "(not used)";
+            table.addRow({{indexName(n)}, {c.kind()}, {c.scope + "." + c.collection},
+                          {expression}, {usedBy}, {speedup, true},
+                          {c.created ? stringprintf("%.1f KB", c.size / 1024.0) : "", true},
+                          {c.created ? stringprintf("%.2f s", c.buildTime) : "", true}});
+        }
+        table.finish();
+
+        // Suggest the commands for the plain value indexes that helped:
+        bool first = true;
+        for (size_t n = 0; n < _candidates.size(); ++n) {
+            Candidate &c = _candidates[n];
+            bool helped = any_of(c.speedups.begin(), c.speedups.end(),
+                                 [&](auto &s) {return c.usedBy.count(s.first) && s.second >= 1.2;});
+            if (!helped || c.kind() != "value")
+                continue;
+            if (first)
+                cout << "\n" << bold("To create the value indexes that helped:") << "\n";
+            first = false;
+            cout << "  mkindex ";
+            if (c.scope != string(slice(kC4DefaultScopeID)))
+                cout << "--scope " << c.scope << " ";
+            if (c.collection != string(slice(kC4DefaultCollectionName)))
+                cout << "--collection " << c.collection << " ";
+            cout << indexName(n) << " " << c.expression() << "\n";
+        }
+    }
+
+
+    unsigned            _runs {5};
+    vector<Query>       _queries;
+    vector<Candidate>   _candidates;
+};
+
+
+CBLiteCommand* newAdviseIndexesCommand(CBLiteTool &parent) {
+    return new AdviseIndexesCommand(parent);
+}
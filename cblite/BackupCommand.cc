@@ -0,0 +1,353 @@
+//
+// BackupCommand.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "CBLiteCommand.hh"
+#include "BlobStoreSync.hh"
+#include "BulkCopier.hh"
+#include "DeltaFile.hh"
+#include "Stopwatch.hh"
+#include "sqlite3.h"
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <thread>
+
+using namespace std;
+using namespace fleece;
+using namespace litecore;
+
+
+class BackupCommand : public CBLiteCommand {
+public:
+
+    BackupCommand(CBLiteTool &parent)
+    :CBLiteCommand(parent)
+    { }
+
+
+    void usage() override {
+        writeUsageCommand("backup", true, "DESTINATION");
+        cerr <<
+        "  Makes a consistent copy of the database while other processes keep using it, copying\n"
+        "  a few pages at a time. Blobs are copied too. DESTINATION must not already exist.\n"
+        "    --step <n> : Number of pages copied per step (default " << kDefaultStep << ")\n"
+        "    --sleep <ms> : Pause between steps, to limit the I/O load (default 0)\n"
+        "    --max-restarts <n> : If the database is changed this many times during the backup,\n"
+        "           copy the rest in one step (default " << kDefaultMaxRestarts << ")\n"
+        "    --check : Run a full integrity check on the backup when done\n"
+        "    --incremental <base> : Instead, write only the changes made since the backup <base>\n"
+        "           (a full backup or an earlier incremental one) to the file DESTINATION\n"
+        "    --verbose or -v : Display progress\n"
+        "  Use `restore` to apply incremental backups to a full one.\n"
+        ;
+    }
+
+
+    void runSubcommand() override {
+        // Read params:
+        processFlags({
+            {"--step",          [&]{_step = parseNextArg<int>("pages per step", 1);}},
+            {"--sleep",         [&]{_sleepMS = parseNextArg<unsigned>("milliseconds to sleep");}},
+            {"--max-restarts",  [&]{_maxRestarts = parseNextArg<unsigned>("number of restarts");}},
+            {"--check",         [&]{_check = true;}},
+            {"--incremental",   [&]{_incrementalBase = nextArg("base backup path");}},
+            {"--verbose",       [&]{verboseFlag();}},
+            {"-v",              [&]{verboseFlag();}},
+        });
+        openDatabaseFromNextArg();
+        string dstPath = nextArg("destination path");
+        endOfArgs();
+
+        if (!_incrementalBase.empty()) {
+            writeDelta(_incrementalBase, dstPath);
+            return;
+        }
+
+        if (c4db_getConfig2(_db)->encryptionKey.algorithm != kC4EncryptionNone)
+            fail("Backing up an encrypted database is not supported");
+        auto [dstParent, dstName] = splitDBPath(dstPath);
+        if (dstName.empty())
+            fail("Destination filename must have a '.cblite2' extension");
+        FilePath srcDir(string(alloc_slice(c4db_getPath(_db))), "");
+        FilePath dstDir(dstPath, "");
+        if (dstDir.exists())
+            fail("Destination " + dstPath + " already exists");
+
+        Stopwatch st;
+        dstDir.mkdir();
+        try {
+            backupSQLite(srcDir["db.sqlite3"], dstDir["db.sqlite3"]);
+            copyAttachments(srcDir, dstDir);
+            validate(dstParent, dstName);
+        } catch (...) {
+            dstDir.delRecursive();
+            throw;
+        }
+        cout << "Backed up to " << dstPath << " in " << st.elapsed() << " secs\n";
+    }
+
+
+private:
+    using SQLiteDB = unique_ptr<sqlite3, decltype(&sqlite3_close)>;
+
+    SQLiteDB openSQLite(const FilePath &file, int flags) {
+        sqlite3 *db = nullptr;
+        int rc = sqlite3_open_v2(file.path().c_str(), &db, flags, nullptr);
+        SQLiteDB result(db, &sqlite3_close);
+        if (rc != SQLITE_OK)
+            fail(stringprintf("Couldn't open %s: %s", file.path().c_str(),
+                              (db ? sqlite3_errmsg(db) : sqlite3_errstr(rc))));
+        return result;
+    }
+
+
+    // Copies the database file using SQLite's online backup API. Each step holds a read lock on
+    // the source only while copying its pages, so other connections can keep reading and
+    // writing in between. If another connection writes to the source, SQLite restarts the
+    // backup from the beginning on the next step, so the result is always a consistent snapshot.
+    void backupSQLite(const FilePath &srcFile, const FilePath &dstFile) {
+        SQLiteDB src = openSQLite(srcFile, SQLITE_OPEN_READONLY);
+        SQLiteDB dst = openSQLite(dstFile, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        sqlite3_backup *backup = sqlite3_backup_init(dst.get(), "main", src.get(), "main");
+        if (!backup)
+            fail(string("Couldn't start backup: ") + sqlite3_errmsg(dst.get()));
+
+        int step = _step;
+        int lastDone = 0;
+        unsigned restarts = 0;
+        int rc;
+        while (true) {
+            rc = sqlite3_backup_step(backup, step);
+            if (rc == SQLITE_DONE) {
+                break;
+            } else if (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+                // (BUSY and LOCKED just mean another connection is holding a lock; try again.)
+                int total = sqlite3_backup_pagecount(backup);
+                int done = total - sqlite3_backup_remaining(backup);
+                if (done < lastDone) {
+                    // The source changed, so the backup started over:
+                    ++restarts;
+                    if (verbose())
+                        cout << "\nDatabase changed; restarting backup (#" << restarts << ")\n";
+                    if (restarts >= _maxRestarts && step > 0) {
+                        cout << "Database keeps changing; copying the rest in one step.\n";
+                        step = -1;
+                    }
+                }
+                lastDone = done;
+                if (verbose()) {
+                    cout << "\rCopied " << done << " of " << total << " pages";
+                    cout.flush();
+                }
+                if (_sleepMS > 0 || rc != SQLITE_OK)
+                    this_thread::sleep_for(chrono::milliseconds(max(_sleepMS, 10u)));
+            } else {
+                break;
+            }
+        }
+        if (verbose())
+            cout << "\n";
+        rc = sqlite3_backup_finish(backup);
+        if (rc != SQLITE_OK)
+            fail(string("Backup failed: ") + sqlite3_errmsg(dst.get()));
+    }
+
+
+    // Copies the blob files. Blobs are immutable and named by their digest, so the ones that
+    // the copied database refers to can't change, and were written before it was.
+    void copyAttachments(const FilePath &srcDB, const FilePath &dstDB) {
+        // Blob files are immutable, so they can be copied after the database file. No hard links,
+        // though: a backup shouldn't share storage with the original.
+        BlobStoreSync sync(srcDB, dstDB);
+        auto result = sync.run();
+        if (verbose())
+            cout << "Blobs: " << result << "\n";
+    }
+
+
+    // Makes sure the backup can be opened as a database.
+    void validate(const string &dir, const string &name) {
+        C4DatabaseConfig2 config = {slice(dir), kC4DB_ReadOnly};
+        C4Error error;
+        c4::ref<C4Database> db = c4db_openNamed(slice(name), &config, &error);
+        if (!db)
+            fail("The backup can't be opened", error);
+        if (_check) {
+            cout << "Checking backup integrity ... ";
+            cout.flush();
+            if (!c4db_maintenance(db, kC4IntegrityCheck, &error)) {
+                cout << "\n";
+                fail("Integrity check of the backup failed", error);
+            }
+            cout << "OK\n";
+        }
+    }
+
+
+    // Writes every document changed since the backup `base` was made, along with the blobs
+    // they reference, to a delta file. Only the changes after `base`'s high-water mark in each
+    // collection are enumerated, so this takes time proportional to the amount of change.
+    void writeDelta(const string &base, const string &dstPath) {
+        if (FilePath(dstPath).exists())
+            fail("Destination " + dstPath + " already exists");
+        Stopwatch st;
+        map<string, uint64_t> baseSeqs = baseSequences(base);
+
+        DeltaHeader header;
+        header.sourceUUID = publicUUIDString(_db);
+        for (auto &spec : allCollections()) {
+            string name(spec.keyspace());
+            uint64_t last = uint64_t(c4coll_getLastSequence(_db->getCollection(spec)));
+            header.collections[name] = {baseSeqs[name], last};
+        }
+
+        ofstream out(dstPath, ios::binary | ios::trunc);
+        if (!out)
+            fail("Couldn't create " + dstPath);
+        out << header.toJSON() << '\n';
+
+        bool versionVectors = usingVersionVectors();
+        C4BlobStore *blobStore = c4db_getBlobStore(_db, nullptr);
+        set<string> blobsWritten;
+        uint64_t nDocs = 0;
+        JSONEncoder enc;
+        auto writeLine = [&] {
+            enc.endDict();
+            out << enc.finish() << '\n';
+            enc.reset();
+        };
+
+        for (auto &[name, range] : header.collections) {
+            if (range.through <= range.since)
+                continue;
+            C4Collection *coll = _db->getCollection(CollectionName(name));
+            C4Error error;
+            C4EnumeratorOptions options = {kC4IncludeNonConflicted | kC4IncludeDeleted};
+            c4::ref<C4DocEnumerator> e = c4coll_enumerateChanges(coll, C4SequenceNumber(range.since),
+                                                                 &options, &error);
+            if (!e)
+                fail("enumerating changes", error);
+            while (c4enum_next(e, &error)) {
+                C4DocumentInfo info;
+                c4enum_getDocumentInfo(e, &info);
+                if (uint64_t(info.sequence) > range.through)
+                    break;      // changed after we started; the next delta will get it
+                c4::ref<C4Document> doc = c4coll_getDoc(coll, info.docID, true, kDocGetAll, &error);
+                if (!doc)
+                    fail("reading document \"" + string(slice(info.docID)) + "\"", error);
+
+                if (doc->selectedRev.flags & kRevHasAttachments) {
+                    BulkCopier::forEachBlob(c4doc_getProperties(doc), [&](const C4BlobKey &key) {
+                        string digest(alloc_slice(c4blob_keyToString(key)));
+                        if (!blobsWritten.insert(digest).second)
+                            return;
+                        C4Error blobError;
+                        alloc_slice data = c4blob_getContents(blobStore, key, &blobError);
+                        if (!data) {
+                            errorOccurred("reading blob " + digest, blobError);
+                            return;
+                        }
+                        enc.beginDict();
+                        enc.writeKey("blob");
+                        enc.writeString(digest);
+                        enc.writeKey("data");
+                        enc.writeData(data);        // JSONEncoder writes data as base64
+                        writeLine();
+                    });
+                }
+
+                alloc_slice json = c4doc_bodyAsJSON(doc, false, &error);
+                enc.beginDict();
+                enc.writeKey("collection");
+                enc.writeString(name);
+                enc.writeKey("id");
+                enc.writeString(info.docID);
+                enc.writeKey("history");
+                enc.beginArray();
+                for (auto &revID : BulkCopier::currentRevisionHistory(doc, versionVectors))
+                    enc.writeString(revID);
+                enc.endArray();
+                if (info.flags & kDocDeleted) {
+                    enc.writeKey("deleted");
+                    enc.writeBool(true);
+                }
+                if (info.expiration) {
+                    enc.writeKey("expiration");
+                    enc.writeInt(info.expiration);
+                }
+                enc.writeKey("body");
+                enc.writeRaw(json ? slice(json) : "{}"_sl);
+                writeLine();
+                ++nDocs;
+            }
+            if (error.code)
+                fail("enumerating changes", error);
+        }
+
+        out.close();
+        if (!out)
+            fail("Error writing " + dstPath);
+        cout << "Wrote " << nDocs << " changed docs and " << blobsWritten.size() << " blobs to "
+             << dstPath << " in " << st.elapsed() << " secs\n";
+    }
+
+
+    // Returns the latest sequence in each collection that the backup `base` contains.
+    map<string, uint64_t> baseSequences(const string &base) {
+        map<string, uint64_t> result;
+        string uuid = publicUUIDString(_db);
+        if (isDatabasePath(base)) {
+            // A full backup has the same UUID and sequences as the database it was made from:
+            auto [dir, name] = splitDBPath(base);
+            C4DatabaseConfig2 config = {slice(dir), kC4DB_ReadOnly};
+            C4Error error;
+            c4::ref<C4Database> db = c4db_openNamed(slice(name), &config, &error);
+            if (!db)
+                fail("Couldn't open base backup " + base, error);
+            if (publicUUIDString(db) != uuid)
+                fail(base + " is not a backup of this database");
+            db->forEachCollection([&](C4CollectionSpec spec) {
+                C4Collection *coll = db->getCollection(spec);
+                result[string(CollectionName(spec).keyspace())] = uint64_t(c4coll_getLastSequence(coll));
+            });
+        } else {
+            DeltaHeader header = DeltaHeader::read(base);
+            if (header.sourceUUID != uuid)
+                fail(base + " is not a backup of this database");
+            for (auto &[name, range] : header.collections)
+                result[name] = range.through;
+        }
+        return result;
+    }
+
+
+    static constexpr int      kDefaultStep = 1024;
+    static constexpr unsigned kDefaultMaxRestarts = 5;
+
+    int         _step {kDefaultStep};
+    unsigned    _sleepMS {0};
+    unsigned    _maxRestarts {kDefaultMaxRestarts};
+    bool        _check {false};
+    string      _incrementalBase;
+};
+
+
+CBLiteCommand* newBackupCommand(CBLiteTool &parent) {
+    return new BackupCommand(parent);
+}
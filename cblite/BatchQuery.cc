@@ -0,0 +1,149 @@
+//
+// BatchQuery.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "BatchQuery.hh"
+
+using namespace std;
+using namespace fleece;
+
+
+// Number of parameter sets each worker runs per block:
+static constexpr size_t kBlockSizePerWorker = 64;
+
+
+BatchQuery::BatchQuery(vector<Connection> connections, vector<ParamSet> paramSets)
+:_paramSets(std::move(paramSets))
+{
+    for (auto &conn : connections)
+        _connections.add(std::move(conn));
+}
+
+
+BatchQuery::~BatchQuery() {
+    _queue.close();
+    if (_producer.joinable())
+        _producer.join();
+}
+
+
+vector<string> BatchQuery::errors() const {
+    lock_guard<mutex> lock(_mutex);
+    return _errors;
+}
+
+
+Array::iterator BatchQuery::columns() const {
+    return Array::iterator(_current.doc.asArray());
+}
+
+
+bool BatchQuery::next() {
+    if (!_started) {
+        _started = true;
+        _producer = thread([this] {produce();});
+    }
+    optional<Row> row = _queue.pop();
+    if (!row)
+        return false;
+    _current = std::move(*row);
+    return true;
+}
+
+
+// Runs on the producer thread: runs blocks of parameter sets in parallel, and queues each
+// block's rows in order while the next block runs on another thread. Stops early if the queue
+// is closed. An exception while running a block is recorded as an error, since there's no caller
+// on this thread to catch it; the rest of that block's parameter sets are skipped.
+void BatchQuery::produce() {
+    auto nWorkers = unsigned(_connections.size());
+    size_t blockSize = nWorkers * kBlockSizePerWorker;
+    auto runBlock = [&](size_t start, vector<vector<Row>> &results) {
+        size_t n = min(blockSize, _paramSets.size() - start);
+        results.assign(n, {});
+        try {
+            parallelFor(n, nWorkers, [&](size_t i) {
+                auto conn = _connections.acquire();
+                results[i] = runWith(conn->query, _paramSets[start + i]);
+            });
+        } catch (const exception &x) {
+            blockFailed(start, n, x.what());
+        } catch (...) {
+            blockFailed(start, n, "unknown exception");
+        }
+    };
+
+    vector<vector<Row>> results, nextResults;
+    if (!_paramSets.empty())
+        runBlock(0, results);
+    for (size_t start = 0; start < _paramSets.size(); start += blockSize) {
+        thread runner;
+        if (start + blockSize < _paramSets.size())
+            runner = thread([&, next = start + blockSize] {runBlock(next, nextResults);});
+        bool abandoned = false;
+        for (auto &rows : results) {
+            for (auto &row : rows) {
+                if (!_queue.push(std::move(row))) {
+                    abandoned = true;
+                    break;
+                }
+            }
+            if (abandoned)
+                break;
+        }
+        if (runner.joinable())
+            runner.join();
+        if (abandoned)
+            return;
+        swap(results, nextResults);
+    }
+    _queue.close();
+}
+
+
+// Records an exception thrown while running the `n` parameter sets starting at `start`.
+void BatchQuery::blockFailed(size_t start, size_t n, const string &what) {
+    lock_guard<mutex> lock(_mutex);
+    _errors.push_back("lines " + to_string(_paramSets[start].line) + "-"
+                      + to_string(_paramSets[start + n - 1].line) + ": " + what);
+}
+
+
+// Runs the query with one parameter set on the current thread. Errors are recorded, not thrown.
+vector<BatchQuery::Row> BatchQuery::runWith(C4Query *query, const ParamSet &paramSet) {
+    vector<Row> rows;
+    C4Error error;
+    c4::ref<C4QueryEnumerator> e = c4query_run(query, paramSet.params, &error);
+    if (e) {
+        // Each row becomes a Fleece array with the line number prepended:
+        Encoder enc;
+        while (c4queryenum_next(e, &error)) {
+            enc.beginArray();
+            enc.writeUInt(paramSet.line);
+            for (Array::iterator i(e->columns); i; ++i)
+                enc.writeValue(i.value());
+            enc.endArray();
+            rows.push_back(Row{enc.finishDoc(), e->missingColumns << 1});
+        }
+    }
+    if (error.code) {
+        alloc_slice message = c4error_getDescription(error);
+        lock_guard<mutex> lock(_mutex);
+        _errors.push_back("line " + to_string(paramSet.line) + ": " + string(message));
+    }
+    return rows;
+}
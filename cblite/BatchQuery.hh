@@ -0,0 +1,79 @@
+//
+// BatchQuery.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "QueryRows.hh"
+#include "Parallel.hh"
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/** Runs one compiled query with many sets of parameters, returning the rows of each, with the
+    line number of the parameter set prepended as an extra first column.
+
+    The parameter sets are divided among worker threads, each running its own copy of the query,
+    compiled on its own connection. Rows still come out in the order of the parameter sets: they're
+    processed in blocks, and a block's rows are returned while the next block is being run. */
+class BatchQuery : public QueryRows {
+public:
+    /// A query, and the (read-only) connection it was compiled on. Each worker uses one.
+    struct Connection {
+        c4::ref<C4Database> db;
+        c4::ref<C4Query>    query;
+    };
+
+    /// A set of query parameters (a JSON object), and the line of the file it came from.
+    struct ParamSet {
+        fleece::alloc_slice params;
+        uint64_t            line;
+    };
+
+    /// Nothing happens until the first call to `next`.
+    BatchQuery(std::vector<Connection> connections, std::vector<ParamSet> paramSets);
+
+    ~BatchQuery();
+
+    bool next() override;
+    fleece::Array::iterator columns() const override;
+    uint64_t missingColumns() const override                    {return _current.missing;}
+
+    /// Errors that occurred running the query with individual parameter sets, or (rarely) while
+    /// running a whole block of them; their rows are skipped. Complete once `next` has returned false.
+    std::vector<std::string> errors() const;
+
+private:
+    struct Row {
+        fleece::Doc doc;                // Fleece array of column values
+        uint64_t    missing = 0;
+    };
+
+    void produce();
+    std::vector<Row> runWith(C4Query*, const ParamSet&);
+    void blockFailed(size_t start, size_t n, const std::string &what);
+
+    ConnectionPool<Connection>      _connections;
+    std::vector<ParamSet>           _paramSets;
+    std::vector<std::string>        _errors;
+    mutable std::mutex              _mutex;         // Protects _errors
+    Row                             _current;
+    BoundedQueue<Row>               _queue {1024};
+    std::thread                     _producer;
+    bool                            _started = false;
+};
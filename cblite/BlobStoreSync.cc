@@ -0,0 +1,157 @@
+//
+// BlobStoreSync.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "BlobStoreSync.hh"
+#include "Parallel.hh"
+#include <cstdio>
+#include <ostream>
+#include <unordered_map>
+
+#ifdef __APPLE__
+    #include <sys/clonefile.h>
+#elif defined(__linux__)
+    #include <fcntl.h>
+    #include <linux/fs.h>
+    #include <sys/ioctl.h>
+#endif
+#ifndef _MSC_VER
+    #include <unistd.h>
+#endif
+
+using namespace std;
+using namespace litecore;
+
+
+BlobStoreSync::BlobStoreSync(const FilePath &srcDB, const FilePath &dstDB)
+:_srcDir(srcDB["Attachments/"])
+,_dstDir(dstDB["Attachments/"])
+,_threads(defaultParallelism())
+{ }
+
+
+BlobStoreSync::Result BlobStoreSync::run() {
+    Result result;
+    if (!_srcDir.exists())
+        return result;
+    if (!_dstDir.exists())
+        _dstDir.mkdir();
+
+    // Find the blobs the destination doesn't have, or has with the wrong size:
+    unordered_map<string,int64_t> existing;
+    _dstDir.forEachFile([&](const FilePath &file) {
+        existing.emplace(file.fileName(), file.dataSize());
+    });
+    vector<FilePath> missing;
+    _srcDir.forEachFile([&](const FilePath &file) {
+        if (file.extension() != ".blob")
+            return;                                 // (e.g. an incomplete temporary file)
+        if (auto i = existing.find(file.fileName()); i == existing.end()) {
+            missing.push_back(file);
+        } else if (i->second != file.dataSize()) {
+            missing.push_back(file);
+            ++result.replaced;
+        } else {
+            ++result.existing;
+        }
+    });
+
+    atomic<uint64_t> cloned {0}, linked {0}, copied {0}, bytes {0};
+    mutex failuresMutex;
+    vector<pair<string,string>> failures;
+    parallelFor(missing.size(), _threads, [&](size_t i) {
+        const FilePath &src = missing[i];
+        try {
+            switch (transfer(src, _dstDir[src.fileName()])) {
+                case Method::Cloned: ++cloned; break;
+                case Method::Linked: ++linked; break;
+                case Method::Copied: ++copied; break;
+            }
+            bytes += src.dataSize();
+        } catch (const std::exception &x) {
+            lock_guard<mutex> lock(failuresMutex);
+            failures.emplace_back(src.fileName(), x.what());
+        }
+    });
+
+    result.cloned = cloned;
+    result.linked = linked;
+    result.copied = copied;
+    result.bytes = bytes;
+    result.failed = failures.size();
+    for (auto &[name, message] : failures)
+        LiteCoreTool::instance()->errorOccurred("copying blob " + name + ": " + message);
+    return result;
+}
+
+
+// Clones, links or copies one file. Clones and copies are made under a temporary name and then
+// renamed, so an interrupted sync never leaves a truncated blob behind.
+BlobStoreSync::Method BlobStoreSync::transfer(const FilePath &src, const FilePath &dst) {
+    string srcPath = src.path(), dstPath = dst.path();
+    string tmpPath = dstPath + ".tmp";
+    auto install = [&] {
+        if (::rename(tmpPath.c_str(), dstPath.c_str()) != 0) {
+            ::remove(tmpPath.c_str());
+            throw runtime_error("couldn't rename " + tmpPath);
+        }
+    };
+
+#ifdef __APPLE__
+    if (clonefile(srcPath.c_str(), tmpPath.c_str(), 0) == 0) {
+        install();
+        return Method::Cloned;
+    }
+#elif defined(__linux__) && defined(FICLONE)
+    if (int in = ::open(srcPath.c_str(), O_RDONLY); in >= 0) {
+        int out = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        bool cloned = out >= 0 && ioctl(out, FICLONE, in) == 0;
+        ::close(in);
+        if (out >= 0)
+            ::close(out);
+        if (cloned) {
+            install();
+            return Method::Cloned;
+        }
+        ::remove(tmpPath.c_str());
+    }
+#endif
+
+#ifndef _MSC_VER
+    if (_allowHardLinks && ::link(srcPath.c_str(), dstPath.c_str()) == 0)
+        return Method::Linked;
+#endif
+
+    src.copyTo(tmpPath);
+    install();
+    return Method::Copied;
+}
+
+
+ostream& operator<< (ostream &out, const BlobStoreSync::Result &r) {
+    out << r.transferred() << " blobs transferred (";
+    if (r.cloned)
+        out << r.cloned << " cloned, ";
+    if (r.linked)
+        out << r.linked << " linked, ";
+    out << r.copied << " copied), " << r.existing << " already present";
+    if (r.replaced)
+        out << ", " << r.replaced << " damaged ones replaced";
+    if (r.failed)
+        out << ", " << r.failed << " failed";
+    return out;
+}
@@ -0,0 +1,67 @@
+//
+// BlobStoreSync.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "CBLiteTool.hh"
+#include <algorithm>
+#include <iosfwd>
+
+
+/** Copies the blob files in one database's `Attachments/` directory to another's, skipping the
+    ones the destination already has. Blob files are immutable and named after their digest, so
+    a file with the same name and size is the same blob; one with a different size is damaged
+    (e.g. truncated by an interrupted copy) and is replaced.
+
+    Each missing file is cloned (copy-on-write) if the filesystem supports it, else hard-linked
+    if that's allowed, else copied; the files are transferred on several threads. */
+class BlobStoreSync {
+public:
+    /// The arguments are the two databases' directories (`*.cblite2/`.)
+    BlobStoreSync(const litecore::FilePath &srcDB, const litecore::FilePath &dstDB);
+
+    /// Allows hard links to the source's files. This is safe for LiteCore, which never
+    /// modifies a blob file, but a backup shouldn't share storage with the original.
+    void setAllowHardLinks(bool allow)              {_allowHardLinks = allow;}
+
+    void setThreads(unsigned n)                     {_threads = std::max(n, 1u);}
+
+    struct Result {
+        uint64_t existing = 0;                      // Already in the destination
+        uint64_t replaced = 0;                      // In the destination but the wrong size
+        uint64_t cloned = 0, linked = 0, copied = 0;
+        uint64_t failed = 0;
+        uint64_t bytes = 0;                         // Total size of blobs transferred
+
+        uint64_t transferred() const                {return cloned + linked + copied;}
+    };
+
+    /// Transfers the missing blobs. Failures to transfer a file are reported through the tool's
+    /// `errorOccurred`, after all the others have been transferred.
+    Result run();
+
+private:
+    enum class Method {Cloned, Linked, Copied};
+    Method transfer(const litecore::FilePath &src, const litecore::FilePath &dst);
+
+    litecore::FilePath  _srcDir, _dstDir;
+    bool                _allowHardLinks {false};
+    unsigned            _threads;
+};
+
+
+std::ostream& operator<< (std::ostream&, const BlobStoreSync::Result&);
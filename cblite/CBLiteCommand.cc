@@ -17,17 +17,21 @@
 //
 
 #include "CBLiteCommand.hh"
+#include "QueryCache.hh"
 #include "c4Database.hh"
 #include <chrono>
+#include <optional>
 
 #ifdef _MSC_VER
     #include <atlbase.h>
-    #include <Shlwapi.h>
-    #pragma comment(lib, "shlwapi.lib")
     #undef min
     #undef max
 #else
-    #include <fnmatch.h>        // POSIX (?)
+    #include <unistd.h>
+#endif
+
+#ifdef __linux__
+    #include <sys/statvfs.h>
 #endif
 
 using namespace litecore;
@@ -35,6 +39,14 @@ using namespace std;
 using namespace fleece;
 
 
+CBLiteCommand::~CBLiteCommand() {
+    // Make sure any output the command buffered comes out before the next command's (or prompt):
+    try {
+        OutputSink::console().flush();
+    } catch (...) { }
+}
+
+
 void CBLiteCommand::writeUsageCommand(const char *cmd, bool hasFlags, const char *otherArgs) {
     cerr << ansiBold();
     if (!interactive())
@@ -79,6 +91,29 @@ string CBLiteCommand::tempDirectory() {
 }
 
 
+string CBLiteCommand::scratchDirectory(uint64_t expectedSize) {
+    if (const char *dir = getenv("CBLITE_SCRATCH_DIR"); dir && *dir)
+        return dir;
+#ifdef __linux__
+    // /dev/shm is a tmpfs on nearly all distros, so writes and fsyncs there never touch a disk.
+    // It's usually sized at half of RAM, which the database competes with; a database that
+    // outgrows it fails with a full disk. So use it only if the database will fit with room to
+    // grow, and still leave some space free. If the size isn't known, use it only if it has
+    // plenty of space, and be ready for the database not to fit.
+    static constexpr uint64_t kMinFreeScratchSpace = 1ull << 30;
+    static constexpr uint64_t kMinFreeSpaceForUnknownSize = 4ull << 30;
+    static constexpr const char* kRAMDir = "/dev/shm/";
+    uint64_t needed = expectedSize ? 2 * expectedSize + kMinFreeScratchSpace
+                                   : kMinFreeSpaceForUnknownSize;
+    struct statvfs fs;
+    if (access(kRAMDir, W_OK) == 0 && statvfs(kRAMDir, &fs) == 0
+            && uint64_t(fs.f_bavail) * fs.f_frsize >= needed)
+        return kRAMDir;
+#endif
+    return tempDirectory();
+}
+
+
 void CBLiteCommand::openDatabaseFromNextArg() {
     if (!_db)
         openDatabase(nextArg("database path"), false);
@@ -154,6 +189,12 @@ bool CBLiteCommand::usingVersionVectors() const {
 }
 
 
+void CBLiteCommand::invalidateQueryCache() {
+    if (auto cache = queryCache())
+        cache->clear();
+}
+
+
 
 std::string CBLiteCommand::formatRevID(fleece::slice revid, bool pretty) {
     if (!usingVersionVectors() || !pretty) {
@@ -288,15 +329,6 @@ void CBLiteCommand::unquoteGlobPattern(string &str) {
 }
 
 
-bool CBLiteCommand::globMatch(const char *name, const char *pattern) {
-#ifdef _MSC_VER
-    return PathMatchSpecA(name, pattern);
-#else
-    return fnmatch(pattern, name, 0) == 0;
-#endif
-}
-
-
 pair<string, string> CBLiteCommand::getCollectionPath(const string& input) const {
     // Historically cblite has used '/' as the delimiter, but '.' has become more common, so accept either.
     pair<string, string> result;
@@ -316,6 +348,11 @@ pair<string, string> CBLiteCommand::getCollectionPath(const string& input) const
 }
 
 
+static inline string_view stringView(slice s) {
+    return string_view((const char*)s.buf, s.size);
+}
+
+
 int64_t CBLiteCommand::enumerateDocs(EnumerateDocsOptions options, EnumerateDocsCallback callback) {
     if (!options.pattern.empty() && !isGlobPattern(options.pattern)) {
         // Optimization when pattern has no metacharacters -- just get the one doc:
@@ -335,13 +372,35 @@ int64_t CBLiteCommand::enumerateDocs(EnumerateDocsOptions options, EnumerateDocs
         return 1;
     }
 
+    if (options.collection == nullptr)
+        options.collection  = collection();
+
+    // A pattern's literal prefix limits the range of docIDs to look at, so rather than walking
+    // all the docs, seek to that range:
+    optional<GlobMatcher> matcher;
+    if (!options.pattern.empty())
+        matcher.emplace(options.pattern);
+    if (!options.bySequence && (!options.after.empty()
+                                || (matcher && !matcher->literalPrefix().empty())))
+        return enumerateDocsInRange(options, matcher ? &*matcher : nullptr, callback);
+
+    uint64_t afterSeq = 0;
+    if (!options.after.empty()) {
+        char *end;
+        afterSeq = strtoull(options.after.c_str(), &end, 10);
+        if (*end != '\0')
+            failMisuse("When listing by sequence, --after takes a sequence number");
+        // A descending changes enumerator always starts at the latest sequence:
+        if (options.flags & kC4Descending)
+            return enumerateDocsInRange(options, matcher ? &*matcher : nullptr, callback);
+    }
+
     C4Error error;
     C4EnumeratorOptions c4Options = {options.flags};
     c4::ref<C4DocEnumerator> e;
-    if (options.collection == nullptr)
-        options.collection  = collection();
     if (options.bySequence)
-        e = c4coll_enumerateChanges(options.collection, 0, &c4Options, &error);
+        e = c4coll_enumerateChanges(options.collection, C4SequenceNumber(afterSeq),
+                                    &c4Options, &error);
     else
         e = c4coll_enumerateAllDocs(options.collection, &c4Options, &error);
     if (!e)
@@ -351,13 +410,8 @@ int64_t CBLiteCommand::enumerateDocs(EnumerateDocsOptions options, EnumerateDocs
     while (c4enum_next(e, &error)) {
         C4DocumentInfo info;
         c4enum_getDocumentInfo(e, &info);
-
-        if (!options.pattern.empty()) {
-            // Check whether docID matches pattern:
-            string docID = slice(info.docID).asString();
-            if (!globMatch(docID.c_str(), options.pattern.c_str()))
-                continue;
-        }
+        if (matcher && !matcher->matches(stringView(info.docID)))
+            continue;
 
         // Handle offset & limit:
         if (options.offset > 0) {
@@ -384,60 +438,129 @@ int64_t CBLiteCommand::enumerateDocs(EnumerateDocsOptions options, EnumerateDocs
 }
 
 
-uint64_t CBLiteCommand::countDocsWhere(C4CollectionSpec coll, const char *what) {
-    string n1ql = stringprintf("SELECT count(*) FROM `%s` WHERE %s",
-                         nameOfCollection(coll).c_str(), what);
+// The C4DocEnumerator always starts at the first docID, so to start after a docID, or at the
+// range of docIDs starting with a pattern's literal prefix, this instead queries META().id, which
+// SQLite can answer by seeking in the primary-key index, and then reads the documents one at a
+// time. Likewise, a descending enumeration by sequence that starts below a given sequence
+// queries META().sequence, which is indexed too.
+int64_t CBLiteCommand::enumerateDocsInRange(EnumerateDocsOptions &options,
+                                            const GlobMatcher *matcher,
+                                            EnumerateDocsCallback callback)
+{
+    bool descending = (options.flags & kC4Descending) != 0;
+    bool onlyConflicts = (options.flags & kC4IncludeNonConflicted) == 0;
+    string prefix, prefixEnd;
+    if (matcher) {
+        prefix = matcher->literalPrefix();
+        prefixEnd = matcher->prefixEnd();
+        if (matcher->isPrefixOnly())
+            matcher = nullptr;      // every docID in the range matches
+    }
+
+    const char *key = options.bySequence ? "META().sequence" : "META().id";
+    string n1ql = stringprintf("SELECT META().id FROM `%s` WHERE true",
+                               nameOfCollection(c4coll_getSpec(options.collection)).c_str());
+    if (!options.after.empty())
+        n1ql += stringprintf(descending ? " AND %s < $after" : " AND %s > $after", key);
+    if (!prefix.empty())
+        n1ql += " AND META().id >= $prefix";
+    if (!prefixEnd.empty())
+        n1ql += " AND META().id < $prefixEnd";
+    if (options.flags & kC4IncludeDeleted)
+        n1ql += " AND (META().deleted OR NOT META().deleted)";  // (mentioning it includes deleted docs)
+    n1ql += stringprintf(descending ? " ORDER BY %s DESC" : " ORDER BY %s", key);
+    if (options.limit >= 0 && !matcher && !onlyConflicts)
+        n1ql += stringprintf(" LIMIT %lld", (long long)(options.offset + options.limit + 1));
+
     C4Error error;
     c4::ref<C4Query> q = c4query_new2(_db, kC4N1QLQuery, slice(n1ql), nullptr, &error);
     if (!q)
         fail("querying database", error);
-    c4::ref<C4QueryEnumerator> e = c4query_run(q, nullslice, &error);
+    JSONEncoder enc;
+    enc.beginDict();
+    enc.writeKey("after");
+    if (options.bySequence)
+        enc.writeUInt(strtoull(options.after.c_str(), nullptr, 10));
+    else
+        enc.writeString(options.after);
+    enc.writeKey("prefix");
+    enc.writeString(prefix);
+    enc.writeKey("prefixEnd");
+    enc.writeString(prefixEnd);
+    enc.endDict();
+    c4::ref<C4QueryEnumerator> e = c4query_run(q, enc.finish(), &error);
     if (!e)
         fail("querying database", error);
-    (void)c4queryenum_next(e, &error);
-    return FLValue_AsUnsigned(FLArrayIterator_GetValueAt(&e->columns, 0));
-}
 
+    int64_t nDocs = 0;
+    while (c4queryenum_next(e, &error)) {
+        slice docID = Value(FLArrayIterator_GetValueAt(&e->columns, 0)).asString();
+        if (matcher && !matcher->matches(stringView(docID)))
+            continue;
+        c4::ref<C4Document> doc = c4coll_getDoc(options.collection, docID, true,
+                                                kDocGetCurrentRev, &error);
+        if (!doc)
+            fail("getting document " + string(docID), error);
+        if (onlyConflicts && !(doc->flags & kDocConflicted))
+            continue;
+
+        // Handle offset & limit:
+        if (options.offset > 0) {
+            --options.offset;
+            continue;
+        }
+        if (++nDocs > options.limit && options.limit >= 0) {
+            error.code = 0;
+            break;
+        }
 
+        C4DocumentInfo info = {};
+        info.flags = doc->flags;
+        info.docID = doc->docID;
+        info.revID = doc->revID;
+        info.sequence = doc->sequence;
+        info.bodySize = c4doc_getRevisionBody(doc).size;
+        info.expiration = c4coll_getDocExpiration(options.collection, docID, nullptr);
+        callback(info, (options.flags & kC4IncludeBodies) ? doc.get() : nullptr);
+    }
+    if (error.code)
+        fail("enumerating documents", error);
+    return nDocs;
+}
 
 
-void CBLiteCommand::rawPrint(Value body, slice docID, slice revID) {
+void CBLiteCommand::rawPrint(Value body, OutputSink &out, slice docID, slice revID) {
     alloc_slice jsonBuf = body.toJSON(_json5, true);
     slice restOfJSON = jsonBuf;
     if (docID) {
         // Splice a synthesized "_id" property into the start of the JSON object:
-        cout << "{" << ansiDim() << ansiItalic()
-        << (_json5 ? "_id" : "\"_id\"") << ":\""
-        << ansiReset() << ansiDim()
-        << docID << "\"";
+        out << '{' << out.dim() << out.italic()
+            << (_json5 ? "_id" : "\"_id\"") << ":\""
+            << out.reset() << out.dim()
+            << docID << '"';
         if (revID) {
-            cout << "," << ansiItalic()
-            << (_json5 ? "_rev" : "\"_rev\"") << ":\""
-            << ansiReset() << ansiDim()
-            << revID << "\"";
+            out << ',' << out.italic()
+                << (_json5 ? "_rev" : "\"_rev\"") << ":\""
+                << out.reset() << out.dim()
+                << revID << '"';
         }
         restOfJSON.moveStart(1);
         if (restOfJSON.size > 1)
-            cout << ", ";
-        cout << ansiReset();
+            out << ", ";
+        out << out.reset();
     }
-    cout << restOfJSON;
+    out << restOfJSON;
 }
 
 
 void CBLiteCommand::prettyPrint(Value value,
-                                ostream &out,
+                                OutputSink &out,
                                 const string &indent,
                                 slice docID,
                                 slice revID,
                                 const set<alloc_slice> *onlyKeys)
 {
-    string reset, dim, italic;
-    if (&out == &std::cout) {
-        reset = ansiReset();
-        dim = ansiDim();
-        italic = ansiItalic();
-    }
+    const string &reset = out.reset(), &dim = out.dim(), &italic = out.italic();
 
     switch (value.type()) {
         case kFLDict: {
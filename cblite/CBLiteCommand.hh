@@ -6,12 +6,17 @@
 
 #pragma once
 #include "CBLiteTool.hh"
+#include "GlobMatcher.hh"
+#include "OutputSink.hh"
 #include <functional>
 #include <iostream>
 #include <set>
 #include <string>
 
 /** Abstract base class of the 'cblite' tool's subcommands. */
+class QueryCache;
+
+
 class CBLiteCommand : public CBLiteTool {
 public:
     /// Starts interactive mode; returns when user quits
@@ -29,6 +34,8 @@ public:
         }
     }
 
+    virtual ~CBLiteCommand();
+
     virtual void usage() override =0;
     virtual void runSubcommand() =0;
 
@@ -40,6 +47,13 @@ public:
 
     virtual bool interactive() const                {return _parent && _parent->interactive();}
 
+    /// The interactive session's cache of compiled queries, or null if not interactive.
+    virtual QueryCache* queryCache()                {return _parent ? _parent->queryCache() : nullptr;}
+
+    /// Empties the query cache. Must be called after changing indexes, since compiled queries
+    /// may use them (or ignore new ones.)
+    void invalidateQueryCache();
+
     C4Collection* collection();
     void setCollectionName(const std::string &name);
     void setScopeName(const std::string &name);
@@ -56,6 +70,12 @@ public:
 
     std::string tempDirectory();
 
+    /// A directory for throwaway databases: $CBLITE_SCRATCH_DIR if set, else a RAM-backed
+    /// filesystem if there is one with room for `expectedSize` bytes to spare, else
+    /// `tempDirectory()`. If the size isn't known (0), the RAM-backed filesystem needs several
+    /// GB free, and the caller should start over in `tempDirectory()` if it fills up.
+    std::string scratchDirectory(uint64_t expectedSize = 0);
+
 protected:
     void writeUsageCommand(const char *cmd, bool hasFlags, const char *otherArgs ="");
 
@@ -67,12 +87,14 @@ protected:
 
     /// Writes un-pretty-printed JSON. If docID and/or revID given, adds them as fake properties.
     void rawPrint(fleece::Value body,
+                  OutputSink &out,
                   fleece::slice docID,
                   fleece::slice revID =fleece::nullslice);
 
     /// Pretty-prints JSON. If docID and/or revID given, adds them as fake properties.
+    /// Keys and metadata are styled if `out` is a color terminal.
     void prettyPrint(fleece::Value value,
-                     std::ostream &out,
+                     OutputSink &out,
                      const std::string &indent ="",
                      fleece::slice docID =fleece::nullslice,
                      fleece::slice revID =fleece::nullslice,
@@ -92,10 +114,10 @@ protected:
     static bool canBeUnquotedJSON5Key(fleece::slice key);
 
     // Pattern matching using the typical shell `*` and `?` metacharacters. A `\` escapes them.
+    // (See GlobMatcher for the matching itself.)
 
     static bool isGlobPattern(std::string &str);
     static void unquoteGlobPattern(std::string &str);
-    bool globMatch(const char *name, const char *pattern);
 
     std::pair<std::string, std::string> getCollectionPath(const std::string& input) const;
 
@@ -108,6 +130,8 @@ protected:
         bool                bySequence = false;
         int64_t             offset = 0, limit = -1;
         std::string         pattern;                    // If non-empty, a "glob" pattern to match
+        std::string         after;                      // If non-empty, start after this docID
+                                                        // (or sequence, if `bySequence`)
     };
 
     /// Callback from `enumerateDocs`. The `C4Document*` is null unless `kC4IncludeBodies` was set.
@@ -115,13 +139,11 @@ protected:
 
     /// Enumerates docs according to the options. Returns number of docs found.
     int64_t enumerateDocs(EnumerateDocsOptions, EnumerateDocsCallback);
+    int64_t enumerateDocsInRange(EnumerateDocsOptions&, const GlobMatcher*, EnumerateDocsCallback);
 
     /// Input-line completion function that completes a partial docID.
     void addDocIDCompletions(ArgumentTokenizer&, std::function<void(const std::string&)> add);
 
-    /// Query utility. `what` is a WHERE clause; count of matching docs is returned.
-    uint64_t countDocsWhere(C4CollectionSpec coll, const char *what);
-
 #pragma mark - COMMON FLAGS:
 
     void bodyFlag()      {_enumFlags |= kC4IncludeBodies;}
@@ -157,6 +179,9 @@ private:
 #pragma mark - FACTORY FUNCTIONS:
 
 
+CBLiteCommand* newAdviseIndexesCommand(CBLiteTool&);
+CBLiteCommand* newBackupCommand(CBLiteTool&);
+CBLiteCommand* newBenchCommand(CBLiteTool&);
 CBLiteCommand* newCatCommand(CBLiteTool&);
 CBLiteCommand* newCheckCommand(CBLiteTool&);
 CBLiteCommand* newCompactCommand(CBLiteTool&);
@@ -177,6 +202,8 @@ CBLiteCommand* newPushCommand(CBLiteTool&);
 CBLiteCommand* newPutCommand(CBLiteTool&);
 CBLiteCommand* newQueryCommand(CBLiteTool&);
 CBLiteCommand* newReindexCommand(CBLiteTool&);
+CBLiteCommand* newReplStatusCommand(CBLiteTool&);
+CBLiteCommand* newRestoreCommand(CBLiteTool&);
 CBLiteCommand* newRevsCommand(CBLiteTool&);
 CBLiteCommand* newRmCommand(CBLiteTool&);
 CBLiteCommand* newRmIndexCommand(CBLiteTool&);
@@ -49,6 +49,9 @@ void CBLiteTool::usage() {
     "  --writeable : Open the database with read+write access\n"
     "\n" <<
     bold("Subcommands:\n") <<
+    "    advise-indexes : propose indexes for a set of queries, and measure them\n"
+    "    backup         : copy the database while it's in use\n"
+    "    bench          : time repeated runs of a query\n"
     "    cat, get       : display document body(ies) as JSON\n"
     "    cd             : set the current collection\n"
     "    check          : check for database corruption\n"
@@ -72,6 +75,8 @@ void CBLiteTool::usage() {
     "    put            : create or modify a document\n"
     "    query, select  : run a N1QL or JSON query\n"
     "    reindex        : drop and recreates an index\n"
+    "    replstatus     : estimate the changes not yet pushed to remotes\n"
+    "    restore        : apply incremental backups to a full backup\n"
     "    revs           : show the revisions of a document\n"
     "    rm             : delete documents\n"
     "    rmindex        : delete an index\n"
@@ -162,6 +167,9 @@ void CBLiteTool::helpCommand() {
 using ToolFactory = CBLiteCommand* (*)(CBLiteTool&);
 
 static constexpr struct {const char* name; ToolFactory factory;} kSubcommands[] = {
+    {"advise-indexes", newAdviseIndexesCommand},
+    {"backup",  newBackupCommand},
+    {"bench",   newBenchCommand},
     {"cat",     newCatCommand},
     {"check",   newCheckCommand},
     {"compact", newCompactCommand},
@@ -184,6 +192,8 @@ static constexpr struct {const char* name; ToolFactory factory;} kSubcommands[]
     {"put",     newPutCommand},
     {"query",   newQueryCommand},
     {"reindex", newReindexCommand},
+    {"replstatus", newReplStatusCommand},
+    {"restore", newRestoreCommand},
     {"revs",    newRevsCommand},
     {"rm",      newRmCommand},
     {"rmindex", newRmIndexCommand},
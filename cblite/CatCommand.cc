@@ -69,16 +69,19 @@ public:
             } else {
                 unquoteGlobPattern(docID); // remove any protective backslashes
                 c4::ref<C4Document> doc = readDoc(docID, kDocGetCurrentRev);
+                if (!doc || (doc->flags & kDocDeleted))
+                    OutputSink::console().flush();      // before writing to cerr
                 if (doc == nullptr) {
                     cerr << "Error: Document \"" << docID << "\" not found.\n";
                 } else if (doc->flags & kDocDeleted) {
                     cerr << "Error: Document \"" << docID << "\" is deleted.\n";
                 } else {
                     catDoc(doc, includeIDs);
-                    cout << '\n';
+                    OutputSink::console() << '\n';
                 }
             }
         }
+        OutputSink::console().flush();
     }
 
 
@@ -0,0 +1,390 @@
+//
+// CollectionStats.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "CollectionStats.hh"
+#include "LiteCoreTool.hh"
+#include "Parallel.hh"
+#include "fleece/Fleece.hh"
+#include <algorithm>
+#include <bit>
+
+using namespace std;
+using namespace fleece;
+
+
+static constexpr slice kCacheStore = "cblite";
+
+// Version of the cache format; caches with a different version are ignored.
+static constexpr uint64_t kCacheVersion = 1;
+
+// Maximum number of sequences (hence documents) in a chunk:
+static constexpr uint64_t kChunkSize = 16384;
+
+// Size of a chunk's Bloom filter: 16 bits per document, with 8 hashes per docID, gives a false-
+// positive rate of about 0.06% when the chunk is full.
+static constexpr size_t kFilterBits = 16 * kChunkSize;
+static constexpr unsigned kFilterHashes = 8;
+
+// If (changed docs × chunks) is more than this, just scan every chunk instead of checking filters:
+static constexpr uint64_t kMaxFilterChecks = 50'000'000;
+
+
+[[noreturn]] static void fail(const string &what, C4Error error) {
+    LiteCoreTool::instance()->fail(what, error);
+}
+
+
+#pragma mark - COLLECTION STATS:
+
+
+void CollectionStats::add(const C4DocumentInfo &info) {
+    count++;
+    if (info.flags & kDocDeleted)        ++deletedCount;
+    if (info.flags & kDocHasAttachments) ++withAttachmentCount;
+    if (info.flags & kDocConflicted)     ++conflictCount;
+    dataSize += info.bodySize;
+    metaSize += info.metaSize;
+
+    auto i = std::min(64 - countl_zero(info.bodySize), 23);
+    sizeHistogram[i]++;
+}
+
+
+CollectionStats& CollectionStats::operator+=(const CollectionStats& other) {
+    count += other.count;
+    dataSize += other.dataSize;
+    metaSize += other.metaSize;
+    deletedCount += other.deletedCount;
+    conflictCount += other.conflictCount;
+    withAttachmentCount += other.withAttachmentCount;
+    for (size_t i = 0; i < std::size(sizeHistogram); ++i)
+        sizeHistogram[i] += other.sizeHistogram[i];
+    return *this;
+}
+
+
+#pragma mark - SCANNER:
+
+
+CollectionStatsScanner::CollectionStatsScanner(C4Database *db, vector<CollectionName> collections)
+:_db(db)
+,_nThreads(defaultParallelism())
+{
+    for (auto &name : collections)
+        _collections.push_back(Collection{std::move(name)});
+}
+
+
+vector<CollectionStats> CollectionStatsScanner::run() {
+    // Find the chunks that need scanning: all the new sequences since the cache, plus, once those
+    // are scanned, any old chunks that lost a changed doc.
+    for (auto &coll : _collections) {
+        C4Error error;
+        C4Collection *c4coll = c4db_getCollection(_db, C4CollectionSpec(coll.name), &error);
+        if (!c4coll)
+            fail("opening collection " + string(coll.name.keyspace()), error);
+        coll.lastSequence = uint64_t(c4coll_getLastSequence(c4coll));
+        uint64_t cachedSequence = 0;
+        if (_useCache)
+            cachedSequence = readCache(coll);
+        if (cachedSequence > coll.lastSequence) {
+            coll.chunks.clear();        // The cache is from some other version of the database
+            cachedSequence = 0;
+        }
+        coll.nOldChunks = coll.chunks.size();
+        for (uint64_t first = cachedSequence + 1; first <= coll.lastSequence; first += kChunkSize) {
+            uint64_t last = std::min(first + kChunkSize - 1, coll.lastSequence);
+            coll.chunks.push_back(Chunk{first, last, {}, {}, true});
+            coll.modified = true;
+        }
+    }
+    scanMarkedChunks();
+
+    for (auto &coll : _collections)
+        markChangedChunks(coll);
+    scanMarkedChunks();
+
+    // Check for purged docs by comparing the live doc counts:
+    bool anyPurged = false;
+    for (auto &coll : _collections) {
+        uint64_t live = 0;
+        for (auto &chunk : coll.chunks)
+            live += chunk.stats.count - chunk.stats.deletedCount;
+        C4Collection *c4coll = c4db_getCollection(_db, C4CollectionSpec(coll.name), nullptr);
+        if (live != c4coll_getDocumentCount(c4coll)) {
+            for (size_t i = 0; i < coll.nOldChunks; ++i)
+                coll.chunks[i].scan = true;
+            anyPurged = true;
+        }
+    }
+    if (anyPurged)
+        scanMarkedChunks();
+    _connections.clear();
+
+    vector<CollectionStats> result;
+    for (auto &coll : _collections) {
+        mergeChunks(coll);
+        if (coll.modified) {
+            if (C4Database *db = writeableConnection())
+                saveCache(db, coll);
+        }
+        CollectionStats stats;
+        for (auto &chunk : coll.chunks)
+            stats += chunk.stats;
+        result.push_back(stats);
+    }
+    return result;
+}
+
+
+// Marks the old chunks that may contain the old revisions of docs changed since the cache.
+void CollectionStatsScanner::markChangedChunks(Collection &coll) {
+    if (coll.changed.empty())
+        return;
+    bool all = (coll.changed.size() * coll.nOldChunks > kMaxFilterChecks);
+    for (size_t i = 0; i < coll.nOldChunks; ++i) {
+        Chunk &chunk = coll.chunks[i];
+        chunk.scan = all || any_of(coll.changed.begin(), coll.changed.end(), [&](DocHash h) {
+            return filterContains(chunk.filter, h);
+        });
+    }
+    coll.changed.clear();
+    coll.changed.shrink_to_fit();
+}
+
+
+// Scans the marked chunks of all collections in parallel, on read-only connections that are
+// opened as needed. The docIDs found in new chunks of a collection with a cache are added to its
+// `changed` list.
+void CollectionStatsScanner::scanMarkedChunks() {
+    vector<pair<Collection*,Chunk*>> tasks;
+    for (auto &coll : _collections) {
+        for (auto &chunk : coll.chunks) {
+            if (chunk.scan)
+                tasks.emplace_back(&coll, &chunk);
+        }
+    }
+    if (tasks.empty())
+        return;
+
+    auto nWorkers = unsigned(std::min(size_t(_nThreads), tasks.size()));
+    C4Error openError;
+    if (!addReadOnlyConnections(_connections, _db, nWorkers, &openError))
+        fail("opening another connection to the database", openError);
+
+    parallelFor(tasks.size(), nWorkers, [&](size_t i) {
+        auto [coll, chunk] = tasks[i];
+        auto conn = _connections.acquire();
+        C4Error error;
+        C4Collection *c4coll = c4db_getCollection(*conn, C4CollectionSpec(coll->name), &error);
+        if (!c4coll)
+            fail("opening collection " + string(coll->name.keyspace()), error);
+        bool isNew = (chunk - coll->chunks.data()) >= ptrdiff_t(coll->nOldChunks);
+        vector<DocHash> changes;
+        scanChunk(c4coll, *chunk, (isNew && coll->nOldChunks > 0 ? &changes : nullptr));
+
+        lock_guard<mutex> lock(_mutex);
+        coll->changed.insert(coll->changed.end(), changes.begin(), changes.end());
+        coll->modified = true;
+    });
+}
+
+
+// Scans the documents in a chunk's sequence range, replacing its stats and filter.
+void CollectionStatsScanner::scanChunk(C4Collection *coll, Chunk &chunk, vector<DocHash> *changes) {
+    chunk.stats = {};
+    chunk.filter.assign(kFilterBits / 8, 0);
+    chunk.scan = false;
+
+    C4Error error;
+    C4EnumeratorOptions options = {kC4IncludeNonConflicted | kC4IncludeDeleted};
+    c4::ref<C4DocEnumerator> e = c4coll_enumerateChanges(coll, C4SequenceNumber(chunk.first - 1),
+                                                         &options, &error);
+    if (!e)
+        fail("creating enumerator", error);
+    while (c4enum_next(e, &error)) {
+        C4DocumentInfo info;
+        c4enum_getDocumentInfo(e, &info);
+        if (uint64_t(info.sequence) > chunk.last) {
+            error.code = 0;
+            break;
+        }
+        chunk.stats.add(info);
+        DocHash hash = hashDocID(info.docID);
+        addToFilter(chunk.filter, hash);
+        if (changes)
+            changes->push_back(hash);
+    }
+    if (error.code)
+        fail("enumerating documents", error);
+    _docsScanned += chunk.stats.count;
+}
+
+
+// Drops empty chunks, and combines adjacent ones whose docs fit in one chunk. (Sequences between
+// two chunks belong to no doc, since a doc that once had one has moved to a newer sequence.)
+void CollectionStatsScanner::mergeChunks(Collection &coll) {
+    vector<Chunk> merged;
+    for (auto &chunk : coll.chunks) {
+        if (chunk.stats.count == 0) {
+            coll.modified = true;
+        } else if (!merged.empty() && merged.back().stats.count + chunk.stats.count <= kChunkSize) {
+            Chunk &prev = merged.back();
+            prev.last = chunk.last;
+            prev.stats += chunk.stats;
+            for (size_t i = 0; i < prev.filter.size(); ++i)
+                prev.filter[i] |= chunk.filter[i];
+            coll.modified = true;
+        } else {
+            merged.push_back(std::move(chunk));
+        }
+    }
+    coll.chunks = std::move(merged);
+}
+
+
+#pragma mark - BLOOM FILTER:
+
+
+// FNV-1a, and a second hash derived from it, for double hashing. These must never change, since
+// the filters are saved in the cache.
+CollectionStatsScanner::DocHash CollectionStatsScanner::hashDocID(slice docID) {
+    uint64_t h = 0xcbf29ce484222325;
+    for (size_t i = 0; i < docID.size; ++i)
+        h = (h ^ docID[i]) * 0x100000001b3;
+    uint64_t h2 = h + 0x9e3779b97f4a7c15;
+    h2 = (h2 ^ (h2 >> 30)) * 0xbf58476d1ce4e5b9;
+    h2 = (h2 ^ (h2 >> 27)) * 0x94d049bb133111eb;
+    h2 ^= (h2 >> 31);
+    return {h, h2 | 1};
+}
+
+
+void CollectionStatsScanner::addToFilter(vector<uint8_t> &filter, DocHash hash) {
+    for (unsigned i = 0; i < kFilterHashes; ++i) {
+        uint64_t bit = (hash.h1 + i * hash.h2) % kFilterBits;
+        filter[bit / 8] |= uint8_t(1 << (bit % 8));
+    }
+}
+
+
+bool CollectionStatsScanner::filterContains(const vector<uint8_t> &filter, DocHash hash) {
+    for (unsigned i = 0; i < kFilterHashes; ++i) {
+        uint64_t bit = (hash.h1 + i * hash.h2) % kFilterBits;
+        if (!(filter[bit / 8] & (1 << (bit % 8))))
+            return false;
+    }
+    return true;
+}
+
+
+#pragma mark - CACHE:
+
+
+static string cacheKey(const CollectionName &name) {
+    return "stats:" + string(name.keyspace());
+}
+
+
+// Reads the collection's cached chunks. Returns the last sequence the cache is up to date with,
+// or 0 if there's no valid cache.
+uint64_t CollectionStatsScanner::readCache(Collection &coll) {
+    C4Error error;
+    C4RawDocument *raw = c4raw_get(_db, kCacheStore, slice(cacheKey(coll.name)), &error);
+    if (!raw)
+        return 0;
+    Doc doc(alloc_slice(raw->body));
+    c4raw_free(raw);
+    if (doc["version"].asUnsigned() != kCacheVersion)
+        return 0;
+
+    // Each chunk is an array [first, last, count, deleted, attachments, conflicts, dataSize,
+    // metaSize, [histogram...], filter]:
+    for (Array::iterator i(doc["chunks"].asArray()); i; ++i) {
+        Array a = i.value().asArray();
+        Chunk chunk {a[0].asUnsigned(), a[1].asUnsigned()};
+        chunk.stats.count               = a[2].asUnsigned();
+        chunk.stats.deletedCount        = a[3].asUnsigned();
+        chunk.stats.withAttachmentCount = a[4].asUnsigned();
+        chunk.stats.conflictCount       = a[5].asUnsigned();
+        chunk.stats.dataSize            = a[6].asUnsigned();
+        chunk.stats.metaSize            = a[7].asUnsigned();
+        Array histogram = a[8].asArray();
+        for (size_t h = 0; h < chunk.stats.sizeHistogram.size(); ++h)
+            chunk.stats.sizeHistogram[h] = histogram[uint32_t(h)].asUnsigned();
+        slice filter = a[9].asData();
+        if (filter.size != kFilterBits / 8) {
+            coll.chunks.clear();
+            return 0;
+        }
+        chunk.filter.assign((const uint8_t*)filter.buf, (const uint8_t*)filter.end());
+        coll.chunks.push_back(std::move(chunk));
+    }
+    return doc["lastSequence"].asUnsigned();
+}
+
+
+void CollectionStatsScanner::saveCache(C4Database *db, const Collection &coll) {
+    Encoder enc;
+    enc.beginDict();
+    enc.writeKey("version");
+    enc.writeUInt(kCacheVersion);
+    enc.writeKey("lastSequence");
+    enc.writeUInt(coll.lastSequence);
+    enc.writeKey("chunks");
+    enc.beginArray();
+    for (auto &chunk : coll.chunks) {
+        enc.beginArray();
+        enc.writeUInt(chunk.first);
+        enc.writeUInt(chunk.last);
+        enc.writeUInt(chunk.stats.count);
+        enc.writeUInt(chunk.stats.deletedCount);
+        enc.writeUInt(chunk.stats.withAttachmentCount);
+        enc.writeUInt(chunk.stats.conflictCount);
+        enc.writeUInt(chunk.stats.dataSize);
+        enc.writeUInt(chunk.stats.metaSize);
+        enc.beginArray();
+        for (auto n : chunk.stats.sizeHistogram)
+            enc.writeUInt(n);
+        enc.endArray();
+        enc.writeData(slice(chunk.filter.data(), chunk.filter.size()));
+        enc.endArray();
+    }
+    enc.endArray();
+    enc.endDict();
+    C4Error error;
+    if (!c4raw_put(db, kCacheStore, slice(cacheKey(coll.name)), nullslice, enc.finish(), &error))
+        fail("saving collection statistics", error);
+}
+
+
+// Returns a writeable connection for saving the cache: `_db` if it's writeable, else a new
+// connection if `_saveCache` is set. Returns null if the cache shouldn't be saved, or if the
+// database can't be opened writeable (e.g. a read-only file.)
+C4Database* CollectionStatsScanner::writeableConnection() {
+    if (!(c4db_getConfig2(_db)->flags & kC4DB_ReadOnly))
+        return _db;
+    if (!_saveCache)
+        return nullptr;
+    if (!_writeableDB) {
+        C4DatabaseConfig2 config = *c4db_getConfig2(_db);
+        config.flags = (config.flags & ~kC4DB_ReadOnly) & ~kC4DB_Create;
+        _writeableDB = c4db_openNamed(c4db_getName(_db), &config, nullptr);
+    }
+    return _writeableDB;
+}
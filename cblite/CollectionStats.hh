@@ -0,0 +1,114 @@
+//
+// CollectionStats.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "CBLiteTool.hh"
+#include "Parallel.hh"
+#include "c4.hh"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+
+/** Document counts and sizes of a collection, including deleted documents. */
+struct CollectionStats {
+    uint64_t count= 0, deletedCount = 0, withAttachmentCount = 0, conflictCount = 0;
+    uint64_t dataSize = 0, metaSize = 0;
+    std::array<uint64_t,24> sizeHistogram = {}; // indexed by log2(dataSize)
+
+    void add(const C4DocumentInfo&);
+    CollectionStats& operator+=(const CollectionStats& other);
+};
+
+
+/** Computes the CollectionStats of collections by scanning their documents' metadata (not
+    bodies.) Collections are divided into chunks -- ranges of sequences -- which are scanned in
+    parallel, each on its own read-only connection.
+
+    The chunks' stats are cached in the database, along with the collection's last sequence, so
+    that the next time, only the documents changed since then need to be scanned. A changed
+    document has a new sequence, so it isn't found in its old chunk anymore; to tell which old
+    chunks lost documents, each chunk also saves a Bloom filter of its docIDs, and the chunks whose
+    filters (may) contain a changed docID are scanned again. Purges don't change sequences, so if
+    the collection's live document count differs from the stats, all of it is scanned again.
+    (A purged deleted document isn't noticed, though.) */
+class CollectionStatsScanner {
+public:
+    /// `db` may be read-only; if so, the cache is only read, unless `setSaveCache(true)` is called.
+    CollectionStatsScanner(C4Database *db, std::vector<CollectionName> collections);
+
+    /// If false, cached stats are ignored and every document is scanned. (The cache is still
+    /// updated.) Defaults to true.
+    void setUseCache(bool use)                      {_useCache = use;}
+
+    /// If true, and `db` is read-only, a separate writeable connection is opened to save the
+    /// cache, if possible. Defaults to false. (If `db` is writeable the cache is always saved.)
+    void setSaveCache(bool save)                    {_saveCache = save;}
+
+    void setThreads(unsigned n)                     {_nThreads = n;}
+
+    /// Returns the stats of each collection, in the order given to the constructor.
+    std::vector<CollectionStats> run();
+
+    /// The number of documents scanned by `run`; the rest came from the cache.
+    uint64_t docsScanned() const                    {return _docsScanned;}
+
+private:
+    struct DocHash {uint64_t h1, h2;};
+
+    // A range of sequences of a collection, and the stats of the documents in it.
+    struct Chunk {
+        uint64_t                first, last;        // Sequence range, inclusive
+        CollectionStats         stats;
+        std::vector<uint8_t>    filter;             // Bloom filter of docIDs
+        bool                    scan = false;       // True if it needs to be scanned
+    };
+
+    struct Collection {
+        CollectionName          name;
+        uint64_t                lastSequence = 0;
+        std::vector<Chunk>      chunks;
+        size_t                  nOldChunks = 0;     // Chunks that came from the cache
+        std::vector<DocHash>    changed;            // Hashes of docIDs changed since the cache
+        bool                    modified = false;   // True if the cache needs saving
+    };
+
+    static DocHash hashDocID(fleece::slice docID);
+    static void addToFilter(std::vector<uint8_t> &filter, DocHash);
+    static bool filterContains(const std::vector<uint8_t> &filter, DocHash);
+
+    uint64_t readCache(Collection&);
+    void saveCache(C4Database*, const Collection&);
+    C4Database* writeableConnection();
+    void markChangedChunks(Collection&);
+    void scanMarkedChunks();
+    void scanChunk(C4Collection*, Chunk&, std::vector<DocHash> *changes);
+    static void mergeChunks(Collection&);
+
+    C4Database*                         _db;
+    std::vector<Collection>             _collections;
+    ConnectionPool<>                    _connections;
+    std::mutex                          _mutex;         // Protects Collection::changed
+    c4::ref<C4Database>                 _writeableDB;
+    unsigned                            _nThreads;
+    std::atomic<uint64_t>               _docsScanned {0};
+    bool                                _useCache = true;
+    bool                                _saveCache = false;
+};
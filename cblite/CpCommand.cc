@@ -17,11 +17,15 @@
 //
 
 #include "CBLiteCommand.hh"
+#include "BlobStoreSync.hh"
 #include "Endpoint.hh"
 #include "RemoteEndpoint.hh"
 #include "DBEndpoint.hh"
+#include "BulkCopier.hh"
 #include "Stopwatch.hh"
 #include "c4Private.h"
+#include <cerrno>
+#include <iomanip>
 #include <optional>
 
 using namespace std;
@@ -49,6 +53,11 @@ public:
 
 
     ~CpCommand() {
+        deleteTemporaryDB();
+    }
+
+
+    void deleteTemporaryDB() {
         if (_tempDir) {
             if (_shouldCloseDB && _db) {
                 C4Error err;
@@ -58,12 +67,14 @@ public:
                     cerr << "Warning: error deleting temporary database: "
                          << c4error_descriptionStr(err) << "\n";
                     cerr << "Database is in " << _tempDir->path() << "\n";
+                    _tempDir = nullopt;
                     return;
                 }
             }
             try {
                 _tempDir->del();
             } catch (...) { }
+            _tempDir = nullopt;
         }
     }
 
@@ -85,7 +96,11 @@ public:
         "DESTINATION" << ansiReset() << "\n"
         "  Copies local and remote databases and JSON files.\n"
         "    --bidi : Bidirectional (push+pull) replication.\n"
+        "    --bulk : Copy local-to-local docs with their revision history, into a new or existing\n"
+        "           database. (Implied by --map.) Doesn't support --limit.\n"
         "    --cacert <file> : Use X.509 certificates in <file> to validate server TLS cert.\n"
+        "    --calibrate : Time a short trial replication from SOURCE with each --profile, and\n"
+        "           report the fastest. (No DESTINATION; trials go to temporary databases.)\n"
         "    --careful : Abort on any error.\n"
         "    --cert <file> : Use X.509 certificate in <file> for TLS client authentication.\n"
         "    --collection <[scope.]name]> : Collection(s) to be replicated; separate with commas.\n"
@@ -99,16 +114,23 @@ public:
         "           whose value is the docID. (Set to \"\" to suppress this.)\n"
         "    --key <file> : Use private key in <file> for TLS client authentication.\n"
         "    --limit <n> : Stop after <n> documents. (Replicator ignores this)\n"
+        "    --map <src>=<dst> : Copy collection <src> into collection <dst>; may be repeated.\n"
+        "    --parallel <n> : Split the collections among <n> concurrent replicators, for\n"
+        "           local-to-local replication [EE]; or the number of --bulk reader threads.\n"
+        "    --profile <name> : Replicator tuning profile: default, bulk (initial load),\n"
+        "           lowlatency (continuous), lowbandwidth\n"
         "    --replicate : Forces use of replicator, for local-to-local db copy [EE]\n"
         "    --user <name>[:<password>] : HTTP Basic auth credentials for remote database.\n"
         "           (If password is not given, the tool will prompt you to enter it.)\n"
         "    --token <token> : Session authentication token for remote database.\n"
+        "    --trial <secs> : Duration of each --calibrate trial (default 10).\n"
         "    --verbose or -v : Display progress; repeat flag for more verbosity.\n\n";
 
         if (interactive()) {
             cerr <<
             "  DESTINATION : Database path, replication URL, or JSON file path:\n"
             "    *.cblite2 :  Copies local database file, and assigns new UUID to target\n"
+            "    *.cblite2 :  With --bulk flag, copies docs & history into new or existing db\n"
             "    *.cblite2 :  With --replicate flag, runs local replication [EE]\n"
             "    ws://*    :  Networked replication\n"
             "    wss://*   :  Networked replication, with TLS\n"
@@ -119,6 +141,7 @@ public:
             cerr <<
             "  SOURCE, DESTINATION : Database path, replication URL, or JSON file path:\n"
             "    *.cblite2 <--> *.cblite2 :  Copies local db file, and assigns new UUID to target\n"
+            "    *.cblite2 <--> *.cblite2 :  With --bulk flag, copies docs & history into new or existing db\n"
             "    *.cblite2 <--> *.cblite2 :  With --replicate flag, runs local replication [EE]\n"
             "    *.cblite2 <--> ws://*    :  Networked replication\n"
             "    *.cblite2 <--> wss://*   :  Networked replication, with TLS\n"
@@ -140,6 +163,8 @@ public:
         cerr << "[FLAGS]" << ' ' << "DB_URL " << ansiReset() << "\n"
         "  Pulls a remote database to a local temporary, then starts interactive mode.\n"
         "    --bidi : Push changes back to the server (continuous mode only.)\n"
+        "    --cache <dir> : Keep the pulled database in <dir> instead of a temporary, so the next\n"
+        "           session only pulls changes. (Default is $CBLITE_CACHE_DIR, if set.)\n"
         "    --cacert <file> : Use X.509 certificates in <file> to validate server TLS cert.\n"
         "    --cert <file> : Use X.509 certificate in <file> for TLS client authentication.\n"
         "    --collection <[scope.]name]> : Adds a collection to the list of collections to be replicated.\n"
@@ -152,10 +177,17 @@ public:
     }
 
 
-    void createTemporaryDB(slice dbName) {
+    // Creates a throwaway database that's deleted when this command exits. Unless `onDisk` is
+    // true, it goes in the scratch directory, which is RAM-backed if possible, so that the
+    // initial pull doesn't pay for journaling and fsyncs to a disk. (The size of the remote
+    // database isn't known, so `pullIntoTemporaryDB` starts over on disk if it doesn't fit.)
+    void createTemporaryDB(slice dbName, bool onDisk =false) {
         if (_db)
             fail("A database is already open");
-        _tempDir = FilePath(tempDirectory(), "").mkTempDir();
+        string dir = onDisk ? tempDirectory() : scratchDirectory();
+        _tempDir = FilePath(dir, "").mkTempDir();
+        _tempDBName = dbName;
+        _tempDBInScratch = (dir != tempDirectory());
         string path = _tempDir->path();
         _dbFlags = kC4DB_Create;
         C4DatabaseConfig2 config = {slice(path), _dbFlags};
@@ -164,15 +196,73 @@ public:
         if (!_db)
             fail("Couldn't create temporary database at " + path, err);
         _shouldCloseDB = true;
+        if (verbose())
+            cout << "Temporary database is in " << path << "\n";
     }
 
 
-    void createTemporaryDBForURL(const string &url) {
+    // Opens the local database that a remote one will be pulled into: a persistent replica in
+    // the cache directory if one was given with `--cache` or $CBLITE_CACHE_DIR, else a temporary DB.
+    void createLocalDBForURL(const string &url) {
         C4Address address;
         C4String dbName;
         if (!c4address_fromURL(slice(url), &address, &dbName))
             fail("Invalid replication URL");
-        createTemporaryDB(dbName);
+        if (_cacheDir.empty()) {
+            if (const char *env = getenv("CBLITE_CACHE_DIR"))
+                _cacheDir = env;
+        }
+        if (_cacheDir.empty())
+            createTemporaryDB(dbName);
+        else
+            openCachedDB(url, dbName);
+    }
+
+
+    // Opens or creates the cached replica of a remote database. Its name is derived from the URL,
+    // user name and collections, so each distinct replication gets its own replica, and the
+    // replicator checkpoints saved in it let the next session pull only what has changed.
+    void openCachedDB(const string &url, slice dbName) {
+        if (_db)
+            fail("A database is already open");
+        string key = url + "\n" + _user.substr(0, _user.find(':'));
+        if (_collections.empty())
+            key += "\n" + string(CollectionName(CollectionName::kDefault).keyspace());
+        for (auto &coll : _collections)
+            key += "\n" + string(coll.keyspace());
+        uint64_t hash = 14695981039346656037ull;     // FNV-1a
+        for (char c : key) {
+            hash ^= uint8_t(c);
+            hash *= 1099511628211ull;
+        }
+        string name = stringprintf("%.*s-%016llx", SPLAT(dbName), (unsigned long long)hash);
+
+        FilePath dir(_cacheDir, "");
+        if (!dir.existsAsDir())
+            dir.mkdir();
+        string path = dir.path();
+        bool existed = c4db_exists(slice(name), slice(path));
+
+        _dbFlags = kC4DB_Create;
+        C4DatabaseConfig2 config = {slice(path), _dbFlags};
+        C4Error err;
+        _db = c4db_openNamed(slice(name), &config, &err);
+        if (!_db)
+            fail("Couldn't open cached database " + name + " in " + path, err);
+        if (existed)
+            cout << "Using cached replica " << alloc_slice(c4db_getPath(_db))
+                 << "; pulling changes since the last session.\n";
+    }
+
+    void profileFlag() {
+        string name = nextArg("tuning profile name");
+        _tuning = ReplicatorTuning::named(name);
+        if (!_tuning) {
+            string names;
+            for (auto n : ReplicatorTuning::profileNames())
+                names += (names.empty() ? "" : ", ") + string(n);
+            failMisuse("Unknown tuning profile '" + name + "'; choose from " + names);
+        }
     }
 
     void collectionFlag() {
@@ -182,11 +272,21 @@ public:
         });
     }
 
+    void mapFlag() {
+        string arg = nextArg("collection mapping");
+        auto eq = arg.find('=');
+        if (eq == string::npos || eq == 0 || eq == arg.size() - 1)
+            failMisuse("--map takes the form <source collection>=<destination collection>");
+        _maps.emplace_back(CollectionName(arg.substr(0, eq)), CollectionName(arg.substr(eq + 1)));
+    }
+
 
     void runSubcommand() override {
         // Read params:
         processFlags({
             {"--bidi",      [&]{_bidi = true;}},
+            {"--bulk",      [&]{_bulk = true;}},
+            {"--cache",     [&]{_cacheDir = nextArg("cache directory");}},
             {"--careful",   [&]{_failOnError = true;}},
             {"--cert",      [&]{certFlag();}},
             {"--collection",[&]{collectionFlag();}},
@@ -197,11 +297,17 @@ public:
             {"--idprefix",  [&]{_idPrefix = nextArg("docID prefix");}},
             {"--key",       [&]{keyFlag();}},
             {"--limit",     [&]{limitFlag();}},
+            {"--map",       [&]{mapFlag();}},
+            {"--parallel",  [&]{_parallel = parseNextArg<unsigned>("number of replicators", 1);
+                                _parallelGiven = true;}},
+            {"--calibrate", [&]{_calibrate = true;}},
+            {"--profile",   [&]{profileFlag();}},
             {"--replicate", [&]{_replicate = true;}},
             {"--rootcerts", [&]{_rootCertsFile = nextArg("rootcerts path");}},
             {"--cacert",    [&]{_rootCertsFile = nextArg("cacert path");}}, // curl uses this name
             {"--user",      [&]{_user = nextArg("user name for replication");}},
             {"--token",     [&]{_sessionToken = nextArg("session token for replication");}},
+            {"--trial",     [&]{_trialTime = parseNextArg<unsigned>("trial duration", 1);}},
             {"--verbose",   [&]{verboseFlag();}},
             {"-v",          [&]{verboseFlag();}},
             {"-x",          [&]{_createDst = false;}},
@@ -212,14 +318,33 @@ public:
             c4log_setLevel(syncLog, max(C4LogLevel(kC4LogDebug), C4LogLevel(kC4LogInfo - verbose() + 2)));
         }
 
+        bool collectionsGiven = !_collections.empty();
         if (_collections.empty())
             _collections.push_back(CollectionName::kDefault);
 
         unique_ptr<Endpoint> src, dst;
 
+        if (!_cacheDir.empty() && !_openRemote)
+            failMisuse("--cache is only used by `openremote`");
+
+        if (_calibrate) {
+            if (_openRemote || _mode == Import || _mode == Export)
+                failMisuse("--calibrate only works with `cp`, `push` or `pull`");
+            try {
+                src = (_db && !hasArgs()) ? Endpoint::create(_db, _collections)
+                                          : Endpoint::create(nextArg("source path/URL"), _collections);
+            } catch (const std::exception &x) {
+                fail("Invalid endpoint: " + string(x.what()));
+            }
+            endOfArgs();
+            calibrate(src.get());
+            return;
+        }
+
+        string url;
         if (_openRemote) {
-            string url = nextArg("remote database URL");
-            createTemporaryDBForURL(url);
+            url = nextArg("remote database URL");
+            createLocalDBForURL(url);
             src = Endpoint::create(url);
             dst = Endpoint::create(_db);
 
@@ -252,6 +377,11 @@ public:
                 || src->isRemote() || dst->isRemote())
             _replicate = true;
 
+        if (_replicate && (_bulk || !_maps.empty()))
+            failMisuse("--bulk and --map can't be used with replication");
+        if ((_bulk || !_maps.empty()) && _limit >= 0)
+            failMisuse("--limit can't be used with --bulk or --map");
+
         if (_replicate) {
             // Set up replicator properties:
             if (_mode == Import || _mode == Export)
@@ -263,59 +393,22 @@ public:
                 localDB = dynamic_cast<DbEndpoint*>(dst.get());
             if (!localDB)
                 failMisuse("Replication requires at least one database to be local");
-            localDB->setBidirectional(_bidi);
-            localDB->setContinuous(_continuous);
-
-            if (!_rootCertsFile.empty())
-                localDB->setRootCerts(readFile(_rootCertsFile));
-
-            alloc_slice cert, keyData, keyPassword;
-            tie(cert, keyData, keyPassword) = getCertAndKeyArgs();
-            if (cert) {
-                localDB->setClientCert(cert);
-                localDB->setClientCertKey(keyData);
-                localDB->setClientCertKeyPassword(keyPassword);
-            }
-
-            if (!_user.empty()) {
-                if (cert)
-                    fail("Cannot use both client cert and HTTP auth");
-
-                if(!_sessionToken.empty())
-                    fail("Cannot use both session token and HTTP auth");
-
-                string user;
-                string password;
-                auto colon = _user.find(':');
-                if (colon != string::npos) {
-                    password = _user.substr(colon+1);
-                    user = _user.substr(0, colon);
-                } else {
-                    user = _user;
-                    password = readPassword(("Server password for " + user + ": ").c_str());
-                    if (password.empty())
-                        exit(1);
-                }
-                localDB->setCredentials({user, password});
-            }
-
-            if(!_sessionToken.empty()) {
-                if (cert)
-                    fail("Cannot use both client cert and session token");
-
-                if(!_user.empty())
-                    fail("Cannot use both session token and HTTP auth");
-
-                localDB->setSessionToken(_sessionToken);
-            }
+            if (_parallel > 1 && (src->isRemote() || dst->isRemote()))
+                failMisuse("--parallel only applies to local-to-local replication");
+            configureReplicator(localDB);
+            localDB->setParallelism(_parallel);
         } else {
             copyLocalDBs = dbToDb;
         }
 
         if (_openRemote && _continuous)
             startContinuousPull(src.get(), dst.get());
+        else if (copyLocalDBs && (_bulk || !_maps.empty()))
+            copyLocalDatabaseInBulk((DbEndpoint*)src.get(), (DbEndpoint*)dst.get(), collectionsGiven);
         else if (copyLocalDBs)
             copyLocalToLocalDatabase((DbEndpoint*)src.get(), (DbEndpoint*)dst.get());
+        else if (_openRemote)
+            pullIntoTemporaryDB(url, src, dst);
         else
             copyDatabase(src.get(), dst.get());
 
@@ -328,6 +421,58 @@ public:
     }
 
 
+    // Applies the replication-related flags to the local endpoint of a replication.
+    void configureReplicator(DbEndpoint *localDB) {
+        localDB->setBidirectional(_bidi);
+        localDB->setContinuous(_continuous);
+        if (_tuning)
+            localDB->setTuning(*_tuning);
+
+        if (!_rootCertsFile.empty())
+            localDB->setRootCerts(readFile(_rootCertsFile));
+
+        alloc_slice cert, keyData, keyPassword;
+        tie(cert, keyData, keyPassword) = getCertAndKeyArgs();
+        if (cert) {
+            localDB->setClientCert(cert);
+            localDB->setClientCertKey(keyData);
+            localDB->setClientCertKeyPassword(keyPassword);
+        }
+
+        if (!_user.empty()) {
+            if (cert)
+                fail("Cannot use both client cert and HTTP auth");
+
+            if(!_sessionToken.empty())
+                fail("Cannot use both session token and HTTP auth");
+
+            string user;
+            string password;
+            auto colon = _user.find(':');
+            if (colon != string::npos) {
+                password = _user.substr(colon+1);
+                user = _user.substr(0, colon);
+            } else {
+                user = _user;
+                password = readPassword(("Server password for " + user + ": ").c_str());
+                if (password.empty())
+                    exit(1);
+                _user = user + ":" + password;     // don't prompt again on the next replication
+            }
+            localDB->setCredentials({user, password});
+        }
+
+        if(!_sessionToken.empty()) {
+            if (cert)
+                fail("Cannot use both client cert and session token");
+
+            if(!_user.empty())
+                fail("Cannot use both session token and HTTP auth");
+
+            localDB->setSessionToken(_sessionToken);
+        }
+    }
+
     void copyDatabase(Endpoint *src, Endpoint *dst) {
         if (_jsonIDProperty.size == 0)
             _jsonIDProperty = nullslice;
@@ -343,6 +488,7 @@ public:
         Stopwatch timer;
         src->copyTo(dst, _limit);
         dst->finish();
+        OutputSink::console().flush();      // docIDs logged by the endpoints
 
         double time = timer.elapsed();
         cout << "Completed " << dst->docCount() << " docs in " << time << " secs; "
@@ -370,6 +516,171 @@ public:
     }
 
 
+    // Copies docs and their revision histories into another local database, which may already
+    // exist, using BulkCopier instead of a replicator. This works in CE, can copy a subset of
+    // the collections, and can rename collections.
+    void copyLocalDatabaseInBulk(DbEndpoint *src, DbEndpoint *dst, bool collectionsGiven) {
+        try {
+            src->prepare(true,  {true, nullslice}, dst);
+            dst->prepare(false, {!_createDst, nullslice}, src);
+        } catch (fail_error const& x) {
+            throw;
+        } catch (const std::exception &x) {
+            fail(x.what());
+        }
+        if (verbose())
+            cout << "Copying documents to " << dst->path() << " ...\n";
+
+        BulkCopier copier(src->database(), dst->database());
+        if (_parallelGiven)
+            copier.setReaderThreads(_parallel);
+        if (!_maps.empty()) {
+            for (auto &[from, to] : _maps)
+                copier.addCollection(from, to);
+        } else if (collectionsGiven) {
+            for (auto &coll : _collections)
+                copier.addCollection(coll, coll);
+        } else {
+            src->database()->forEachCollection([&](C4CollectionSpec spec) {
+                copier.addCollection(CollectionName(spec), CollectionName(spec));
+            });
+        }
+
+        Stopwatch timer;
+        if (!collectionsGiven && _maps.empty()) {
+            // Copying everything, so transfer the whole blob store up front; it's much faster
+            // than copying blobs one document at a time, and the copier skips blobs that exist.
+            auto dbDir = [](DbEndpoint *db) {
+                return FilePath(string(alloc_slice(c4db_getPath(db->database()))), "");
+            };
+            BlobStoreSync sync(dbDir(src), dbDir(dst));
+            sync.setAllowHardLinks(true);
+            if (_parallelGiven)
+                sync.setThreads(_parallel);
+            auto result = sync.run();
+            if (verbose())
+                cout << "Blobs: " << result << "\n";
+        }
+        copier.run();
+        dst->finish();
+        double time = timer.elapsed();
+
+        for (auto &c : copier.counts()) {
+            cout << "    " << c.source.keyspace();
+            if (c.target.keyspace() != c.source.keyspace())
+                cout << " -> " << c.target.keyspace();
+            cout << ": " << c.docs << " docs";
+            if (c.unchanged > 0)
+                cout << ", " << c.unchanged << " already up to date";
+            if (c.conflicts > 0)
+                cout << ", " << ansiRed() << c.conflicts << " skipped due to conflicts" << ansiReset();
+            cout << "\n";
+        }
+        uint64_t total = copier.totalDocs();
+        cout << "Completed " << total << " docs";
+        if (copier.blobsCopied() > 0)
+            cout << " and " << copier.blobsCopied() << " blobs";
+        cout << " in " << time << " secs; " << int(total / time) << " docs/sec\n";
+        if (_errorCount > 0)
+            cerr << "** " << _errorCount << " errors occurred; see above **\n";
+    }
+
+
+    // Runs a short trial replication from `src` into a temporary database with each tuning
+    // profile, and reports which one moved documents the fastest.
+    void calibrate(Endpoint *src) {
+        auto remoteSrc = dynamic_cast<RemoteEndpoint*>(src);
+        auto localSrc = dynamic_cast<DbEndpoint*>(src);
+        if (!remoteSrc && !localSrc)
+            failMisuse("--calibrate requires a database path or replication URL as the source");
+#ifndef COUCHBASE_ENTERPRISE
+        if (localSrc)
+            fail("Calibrating local-to-local replication requires the Enterprise Edition");
+#endif
+        if (_continuous || _bidi)
+            failMisuse("--calibrate can't be combined with --continuous or --bidi");
+
+        cout << "Calibrating replication from " << (remoteSrc ? "remote" : "local")
+             << " database, " << _trialTime << " secs per profile ...\n";
+
+        struct Trial {
+            string_view profile;
+            uint64_t    docs {0};
+            double      time {0};
+            C4Error     error {};
+        };
+        vector<Trial> trials;
+
+        for (auto name : ReplicatorTuning::profileNames()) {
+            cout << "    " << name << " ...";
+            cout.flush();
+            _tuning = ReplicatorTuning::named(name);
+            Trial &trial = trials.emplace_back(Trial{name});
+
+            FilePath dir = FilePath(scratchDirectory(), "").mkTempDir();
+            C4DatabaseConfig2 config = {slice(dir.path()), kC4DB_Create};
+            C4Error err;
+            c4::ref<C4Database> db = c4db_openNamed("calibrate"_sl, &config, &err);
+            if (!db)
+                fail("Couldn't create temporary database at " + dir.path(), err);
+            {
+                DbEndpoint target(db, _collections);
+                C4ReplicatorStatus status;
+                try {
+                    src->prepare(true,  {true, nullslice}, &target);
+                    target.prepare(false, {true, nullslice}, src);
+                } catch (fail_error const& x) {
+                    throw;
+                } catch (const std::exception &x) {
+                    fail(x.what());
+                }
+                if (remoteSrc) {
+                    configureReplicator(&target);
+                    target.startReplicationWith(*remoteSrc, false);
+                    status = target.replicateFor(_trialTime, trial.time);
+                } else {
+                    configureReplicator(localSrc);
+                    localSrc->startPushToLocal(target);
+                    status = localSrc->replicateFor(_trialTime, trial.time);
+                }
+                trial.docs = status.progress.documentCount;
+                trial.error = status.error;
+            }
+            if (!c4db_delete(db, &err))
+                cerr << "Warning: error deleting temporary database: " << c4error_descriptionStr(err) << "\n";
+            db = nullptr;
+            try {
+                dir.del();
+            } catch (...) { }
+
+            if (trial.error.code)
+                cout << " error: " << c4error_descriptionStr(trial.error) << "\n";
+            else
+                cout << " " << trial.docs << " docs\n";
+        }
+
+        cout << "\n" << ansiUnderline() << "Profile            Docs      Secs   Docs/sec" << ansiReset() << "\n";
+        const Trial *best = nullptr;
+        for (auto &trial : trials) {
+            double rate = trial.time > 0 ? trial.docs / trial.time : 0;
+            cout << left << setw(13) << trial.profile << right
+                 << setw(9) << trial.docs << ' '
+                 << setw(9) << fixed << setprecision(1) << trial.time << defaultfloat << ' '
+                 << setw(10) << uint64_t(rate);
+            if (trial.error.code)
+                cout << ansiRed() << "  (failed)" << ansiReset();
+            cout << "\n";
+            if (!trial.error.code && trial.docs > 0 && (!best || rate > best->docs / best->time))
+                best = &trial;
+        }
+        if (best)
+            cout << "Fastest: " << bold(string(best->profile).c_str())
+                 << " -- use `--profile " << best->profile << "`\n";
+        else
+            cout << "No profile transferred any documents; nothing to compare.\n";
+    }
+
+
     void startContinuousPull(Endpoint *src, Endpoint *dst) {
         try {
             src->prepare(true,  {true, nullslice}, dst);
@@ -399,13 +710,43 @@ public:
         auto oldVerbose = CBLiteTool::instance()->verbose();
         CBLiteTool::instance()->setVerbose(1);
 
-        auto src = Endpoint::createRemote(url);
-        auto dst = Endpoint::create(_db);
-        copyDatabase(src.get(), dst.get());
+        unique_ptr<Endpoint> src = Endpoint::createRemote(url);
+        unique_ptr<Endpoint> dst = Endpoint::create(_db);
+        pullIntoTemporaryDB(url, src, dst);
         
         CBLiteTool::instance()->setVerbose(oldVerbose);
     }
 
+
+    // Pulls a remote database into the local one. If that's a temporary database in a scratch
+    // directory, and the directory fills up, starts over with a temporary database on disk.
+    void pullIntoTemporaryDB(const string &url, unique_ptr<Endpoint> &src, unique_ptr<Endpoint> &dst) {
+        try {
+            copyDatabase(src.get(), dst.get());
+        } catch (fail_error const&) {
+            auto localDB = dynamic_cast<DbEndpoint*>(dst.get());
+            if (!_tempDir || !_tempDBInScratch || !localDB || !isDiskFull(localDB->replicationError()))
+                throw;
+            cerr << "The scratch directory is full; pulling into " << tempDirectory()
+                 << " instead.\n";
+            src.reset();
+            dst.reset();
+            alloc_slice dbName = _tempDBName;
+            deleteTemporaryDB();
+            createTemporaryDB(dbName, true);
+            src = Endpoint::create(url);
+            dst = Endpoint::create(_db);
+            configureReplicator(dynamic_cast<DbEndpoint*>(dst.get()));
+            copyDatabase(src.get(), dst.get());
+        }
+    }
+
+
+    static bool isDiskFull(C4Error error) {
+        return (error.domain == SQLiteDomain && (error.code & 0xFF) == 13)     // SQLITE_FULL
+            || (error.domain == POSIXDomain && error.code == ENOSPC);
+    }
+
 private:
     Mode const              _mode;
     bool                    _createDst {true};
@@ -413,12 +754,22 @@ private:
     bool                    _continuous {false};
     bool                    _replicate {false};
     bool                    _openRemote {false};
+    bool                    _calibrate {false};
+    unsigned                _trialTime {10};
+    unsigned                _parallel {1};
+    bool                    _parallelGiven {false};
+    bool                    _bulk {false};
+    vector<pair<CollectionName,CollectionName>> _maps;
+    optional<ReplicatorTuning> _tuning;
     alloc_slice             _jsonIDProperty {"_id"};
     alloc_slice             _idPrefix;
     std::string             _rootCertsFile;
     string                  _user;
     string                  _sessionToken;
+    string                  _cacheDir;
     optional<FilePath>      _tempDir;
+    alloc_slice             _tempDBName;
+    bool                    _tempDBInScratch {false};
     std::vector<CollectionName> _collections;
 };
 
@@ -462,7 +813,7 @@ CBLiteCommand* newOpenRemoteCommand(CBLiteTool &parent) {
 
 void CBLiteCommand::runInteractiveWithURL(CBLiteTool &parent, const string &databaseURL) {
     CpCommand cmd(parent, CpCommand::Pull, true);
-    cmd.createTemporaryDBForURL(databaseURL);
+    cmd.createLocalDBForURL(databaseURL);
     cmd.setVerbose(1);
     cmd.pullRemoteDatabase(databaseURL);
     CBLiteCommand::runInteractive(cmd);
@@ -0,0 +1,78 @@
+//
+// DeltaFile.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "DeltaFile.hh"
+#include "fleece/Fleece.hh"
+#include <fstream>
+
+using namespace std;
+using namespace fleece;
+
+
+alloc_slice DeltaHeader::toJSON() const {
+    JSONEncoder enc;
+    enc.beginDict();
+    enc.writeKey(kFormatKey);
+    enc.writeInt(kFormatVersion);
+    enc.writeKey("source");
+    enc.writeString(sourceUUID);
+    enc.writeKey("collections");
+    enc.beginDict();
+    for (auto &[name, range] : collections) {
+        enc.writeKey(name);
+        enc.beginDict();
+        enc.writeKey("since");
+        enc.writeUInt(range.since);
+        enc.writeKey("through");
+        enc.writeUInt(range.through);
+        enc.endDict();
+    }
+    enc.endDict();
+    enc.endDict();
+    return enc.finish();
+}
+
+
+DeltaHeader DeltaHeader::read(const string &path) {
+    ifstream in(path, ios::binary);
+    string line;
+    if (!in || !getline(in, line))
+        LiteCoreTool::instance()->fail("Couldn't read " + path);
+    Doc doc = Doc::fromJSON(line, nullptr);
+    Dict root = doc.asDict();
+    if (root[kFormatKey].asInt() != kFormatVersion)
+        LiteCoreTool::instance()->fail(path + " is not an incremental backup file");
+
+    DeltaHeader header;
+    header.sourceUUID = string(root["source"].asString());
+    for (Dict::iterator i(root["collections"].asDict()); i; ++i) {
+        Dict range = i.value().asDict();
+        header.collections[string(i.keyString())] = {range["since"].asUnsigned(),
+                                                     range["through"].asUnsigned()};
+    }
+    return header;
+}
+
+
+string publicUUIDString(C4Database *db) {
+    C4UUID publicUUID, privateUUID;
+    C4Error error;
+    if (!c4db_getUUIDs(db, &publicUUID, &privateUUID, &error))
+        LiteCoreTool::instance()->fail("reading database UUID", error);
+    return slice(&publicUUID, sizeof(publicUUID)).hexString();
+}
@@ -0,0 +1,55 @@
+//
+// DeltaFile.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "CBLiteTool.hh"
+#include <map>
+#include <string>
+
+/*  An incremental backup ("delta") file, written by `backup --incremental` and applied by
+    `restore`, is a text file with one JSON object per line:
+    1. A header, as below.
+    2. Any number of blob lines, `{"blob": DIGEST, "data": BASE64}`
+    3. Any number of document lines, `{"collection": KEYSPACE, "id": DOCID, "history": [REVIDS],
+       "deleted": BOOL, "expiration": TIMESTAMP, "body": {...}}`
+    A blob line always comes before the first document that references it. */
+
+
+/** The first line of a delta file. It identifies the source database and the range of
+    sequences copied from each collection. */
+struct DeltaHeader {
+    struct Range {
+        uint64_t since = 0;         // Changes after this sequence...
+        uint64_t through = 0;       // ...up to and including this one
+    };
+
+    std::string                     sourceUUID;     // Hex public UUID of the source database
+    std::map<std::string, Range>    collections;    // Keyed by collection keyspace
+
+    fleece::alloc_slice toJSON() const;
+
+    /// Reads the header from a delta file. Fails if the file isn't a delta file.
+    static DeltaHeader read(const std::string &path);
+
+    static constexpr const char* kFormatKey = "cbliteDelta";
+    static constexpr int         kFormatVersion = 1;
+};
+
+
+/// Returns a database's public UUID as a hex string.
+std::string publicUUIDString(C4Database*);
@@ -98,8 +98,10 @@ public:
                         << "\" of database \"" << slice(c4db_getName(_db)) << "\".\n"
                    "// Any changes you make will be saved back to the database when you exit.\n"
                    "// To cancel, exit the editor without saving changes.\n\n";
-            prettyPrint(Dict(c4doc_getProperties(doc)), out);
             json = out.str();
+            OutputSink jsonOut(&json);
+            prettyPrint(Dict(c4doc_getProperties(doc)), jsonOut);
+            jsonOut.flush();
         } else {
             auto raw = alloc_slice(c4doc_bodyAsJSON(doc, true, nullptr));
             json = string(raw) + "\n";
@@ -0,0 +1,271 @@
+//
+// FederatedQuery.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "FederatedQuery.hh"
+#include "CBLiteTool.hh"
+#include <algorithm>
+
+using namespace std;
+using namespace fleece;
+
+
+namespace {
+
+    // Compares two values in N1QL collation order: MISSING < null < booleans < numbers < strings
+    // < data < arrays < dicts. (An undefined Value stands for MISSING.) Strings compare by their
+    // UTF-8 bytes, as in LiteCore's default collation.
+    int compareValues(Value a, Value b) {
+        FLValueType ta = a.type(), tb = b.type();
+        if (ta != tb)
+            return (ta < tb) ? -1 : 1;
+        switch (ta) {
+            case kFLBoolean:
+                return int(a.asBool()) - int(b.asBool());
+            case kFLNumber:
+                if (a.isInteger() && b.isInteger() && !a.isUnsigned() && !b.isUnsigned()) {
+                    int64_t ia = a.asInt(), ib = b.asInt();
+                    return (ia < ib) ? -1 : (ia > ib);
+                } else {
+                    double da = a.asDouble(), db = b.asDouble();
+                    return (da < db) ? -1 : (da > db);
+                }
+            case kFLString:
+                return a.asString().compare(b.asString());
+            case kFLData:
+                return a.asData().compare(b.asData());
+            case kFLArray: {
+                Array::iterator i(a.asArray()), j(b.asArray());
+                for (; i && j; ++i, ++j) {
+                    if (int cmp = compareValues(i.value(), j.value()); cmp != 0)
+                        return cmp;
+                }
+                return int(bool(i)) - int(bool(j));
+            }
+            case kFLDict:
+                return alloc_slice(a.toJSON(false, true)).compare(b.toJSON(false, true));
+            default:
+                return 0;
+        }
+    }
+
+}
+
+
+FederatedQuery::FederatedQuery(vector<string> dbPaths, string n1ql, alloc_slice params,
+                               Options options)
+:_dbPaths(std::move(dbPaths))
+,_n1ql(std::move(n1ql))
+,_params(std::move(params))
+,_options(std::move(options))
+{ }
+
+
+FederatedQuery::~FederatedQuery() {
+    stop();
+}
+
+
+vector<string> FederatedQuery::errors() const {
+    lock_guard<mutex> lock(_errorsMutex);
+    return _errors;
+}
+
+
+Array::iterator FederatedQuery::columns() const {
+    return Array::iterator(_current.doc.asArray());
+}
+
+
+bool FederatedQuery::next() {
+    if (!_started)
+        start();
+    if (_options.limit >= 0 && _returned >= _options.limit) {
+        stop();
+        return false;
+    }
+    if (!nextRow()) {
+        stop();
+        return false;
+    }
+    ++_returned;
+    return true;
+}
+
+
+void FederatedQuery::start() {
+    _started = true;
+    size_t nDBs = _dbPaths.size();
+    if (_options.descending.empty()) {
+        // Unsorted: workers push rows into the queue as they go; the queue's capacity bounds the
+        // memory used, and closing it early makes the workers stop.
+        _producer = thread([this, nDBs] {
+            try {
+                parallelFor(nDBs, _options.jobs, [&](size_t i) {
+                    runOn(i, [&](Row row) {return _queue.push(std::move(row));});
+                });
+            } catch (const exception &x) {
+                lock_guard<mutex> lock(_errorsMutex);
+                _errors.push_back(x.what());
+            }
+            _queue.close();
+        });
+    } else {
+        // Sorted: start each database's query, and read its first row. Its other rows are read
+        // from its enumerator one at a time as the merge consumes them.
+        _sources.resize(nDBs);
+        vector<char> hasRows(nDBs, false);
+        parallelFor(nDBs, _options.jobs, [&](size_t i) {
+            Encoder enc;
+            hasRows[i] = open(i, _sources[i]) && read(i, _sources[i], enc, _sources[i].head);
+        });
+        auto after = [this](size_t a, size_t b) {
+            return sortsBefore(_sources[b].head, b, _sources[a].head, a);
+        };
+        for (size_t i = 0; i < nDBs; ++i) {
+            if (hasRows[i])
+                _heap.push_back(i);
+            else
+                _sources[i] = Source{};
+        }
+        make_heap(_heap.begin(), _heap.end(), after);
+    }
+
+    // Skip the global offset:
+    for (int64_t n = 0; n < _options.offset; ++n) {
+        if (!nextRow())
+            break;
+    }
+}
+
+
+void FederatedQuery::stop() {
+    _queue.close();
+    if (_producer.joinable())
+        _producer.join();
+}
+
+
+// Reads the next row of the combined results into `_current`, before applying offset and limit.
+bool FederatedQuery::nextRow() {
+    if (_options.descending.empty()) {
+        optional<Row> row = _queue.pop();
+        if (!row)
+            return false;
+        _current = std::move(*row);
+    } else {
+        if (_heap.empty())
+            return false;
+        auto after = [this](size_t a, size_t b) {
+            return sortsBefore(_sources[b].head, b, _sources[a].head, a);
+        };
+        pop_heap(_heap.begin(), _heap.end(), after);
+        size_t db = _heap.back();
+        Source &source = _sources[db];
+        _current = std::move(source.head);
+        if (read(db, source, _encoder, source.head)) {
+            push_heap(_heap.begin(), _heap.end(), after);
+        } else {
+            _heap.pop_back();
+            source = Source{};          // Close the database
+        }
+    }
+    return true;
+}
+
+
+// Opens a database and starts running the query on it. Errors are recorded, not thrown.
+bool FederatedQuery::open(size_t dbIndex, Source &source) {
+    auto [dir, name] = CBLiteTool::splitDBPath(_dbPaths[dbIndex]);
+    source.name = name;
+    C4DatabaseConfig2 config = {slice(dir), kC4DB_ReadOnly};
+    C4Error error;
+    source.db = c4db_openNamed(slice(name), &config, &error);
+    if (!source.db) {
+        addError(dbIndex, "opening", error);
+        return false;
+    }
+    source.query = c4query_new2(source.db, kC4N1QLQuery, slice(_n1ql), nullptr, &error);
+    if (!source.query) {
+        addError(dbIndex, "compiling query on", error);
+        return false;
+    }
+    source.e = c4query_run(source.query, _params, &error);
+    if (!source.e) {
+        addError(dbIndex, "querying", error);
+        return false;
+    }
+    return true;
+}
+
+
+// Reads a database's next row, as a Fleece array with the database name prepended. Returns
+// false at the end of the rows, or on an error, which is recorded.
+bool FederatedQuery::read(size_t dbIndex, Source &source, Encoder &enc, Row &row) {
+    C4Error error;
+    if (!c4queryenum_next(source.e, &error)) {
+        if (error.code)
+            addError(dbIndex, "querying", error);
+        return false;
+    }
+    enc.beginArray();
+    enc.writeString(source.name);
+    for (Array::iterator i(source.e->columns); i; ++i)
+        enc.writeValue(i.value());
+    enc.endArray();
+    row = Row{enc.finishDoc(), source.e->missingColumns << 1};
+    return true;
+}
+
+
+// Queries one database on the current thread, calling `emit` with each row until it returns
+// false.
+void FederatedQuery::runOn(size_t dbIndex, const function<bool(Row)> &emit) {
+    Source source;
+    if (!open(dbIndex, source))
+        return;
+    Encoder enc;
+    Row row;
+    while (read(dbIndex, source, enc, row)) {
+        if (!emit(std::move(row)))
+            return;
+    }
+}
+
+
+void FederatedQuery::addError(size_t dbIndex, const string &what, C4Error error) {
+    alloc_slice message = c4error_getDescription(error);
+    lock_guard<mutex> lock(_errorsMutex);
+    _errors.push_back(what + " " + _dbPaths[dbIndex] + ": " + string(message));
+}
+
+
+// Compares rows by their sort keys, the last columns. Ties go to the earlier database, so rows
+// that sort equal come out in a consistent order.
+bool FederatedQuery::sortsBefore(const Row &a, size_t aDB, const Row &b, size_t bDB) const {
+    Array colsA = a.doc.asArray(), colsB = b.doc.asArray();
+    uint32_t nKeys = uint32_t(_options.descending.size());
+    uint32_t first = colsA.count() - nKeys;
+    for (uint32_t k = 0; k < nKeys; ++k) {
+        uint32_t col = first + k;
+        Value va = (a.missing & (1ull << col)) ? Value() : colsA[col];
+        Value vb = (b.missing & (1ull << col)) ? Value() : colsB[col];
+        if (int cmp = compareValues(va, vb); cmp != 0)
+            return _options.descending[k] ? (cmp > 0) : (cmp < 0);
+    }
+    return aDB < bDB;
+}
@@ -0,0 +1,105 @@
+//
+// FederatedQuery.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "QueryRows.hh"
+#include "Parallel.hh"
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/** Runs a N1QL query on many databases, each opened read-only on a worker thread, and returns
+    the combined rows, each with the database's name prepended as an extra first column.
+
+    Without sort keys, rows are returned as soon as any database produces them. With sort keys,
+    which must be the last columns of the query's results, the queries are all started, and then
+    each database's (sorted) rows are read from its query enumerator as they're merged, so the
+    combined rows are in order too. */
+class FederatedQuery : public QueryRows {
+public:
+    struct Options {
+        unsigned            jobs = defaultParallelism();    // Max number of DBs queried at once
+        std::vector<bool>   descending;     // Sort key columns, at the end of each row
+        int64_t             offset = 0;     // Skip this many rows of the combined results
+        int64_t             limit = -1;     // Stop after this many rows of the combined results
+    };
+
+    /// The query is compiled and run separately on each database, with the same parameters.
+    /// Nothing happens until the first call to `next`.
+    FederatedQuery(std::vector<std::string> dbPaths,
+                   std::string n1ql,
+                   fleece::alloc_slice params,
+                   Options);
+
+    ~FederatedQuery();
+
+    bool next() override;
+    fleece::Array::iterator columns() const override;
+    uint64_t missingColumns() const override                    {return _current.missing;}
+
+    /// Errors that occurred opening or querying individual databases; their rows are skipped.
+    /// Complete once `next` has returned false.
+    std::vector<std::string> errors() const;
+
+private:
+    struct Row {
+        fleece::Doc doc;                // Fleece array of column values
+        uint64_t    missing = 0;
+    };
+
+    // A database being queried.
+    struct Source {
+        std::string                     name;
+        c4::ref<C4Database>             db;
+        c4::ref<C4Query>                query;
+        c4::ref<C4QueryEnumerator>      e;
+        Row                             head;       // Sorted: the next row to merge
+    };
+
+    void start();
+    void stop();
+    bool nextRow();
+    bool open(size_t dbIndex, Source&);
+    bool read(size_t dbIndex, Source&, fleece::Encoder&, Row&);
+    void runOn(size_t dbIndex, const std::function<bool(Row)> &emit);
+    void addError(size_t dbIndex, const std::string &what, C4Error);
+    bool sortsBefore(const Row&, size_t aDB, const Row&, size_t bDB) const;
+
+    std::vector<std::string>        _dbPaths;
+    std::string                     _n1ql;
+    fleece::alloc_slice             _params;
+    Options                         _options;
+    std::vector<std::string>        _errors;
+    mutable std::mutex              _errorsMutex;
+    Row                             _current;
+    int64_t                         _returned = 0;
+    bool                            _started = false;
+
+    // Unsorted: rows stream through a queue from a producer thread.
+    BoundedQueue<Row>               _queue {1024};
+    std::thread                     _producer;
+
+    // Sorted: each database's query, and a heap of the indexes of those with rows left, ordered
+    // by their next rows.
+    std::vector<Source>             _sources;
+    std::vector<size_t>             _heap;
+    fleece::Encoder                 _encoder;
+};
@@ -0,0 +1,135 @@
+//
+// GlobMatcher.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "GlobMatcher.hh"
+
+using namespace std;
+
+
+GlobMatcher::GlobMatcher(string_view pattern) {
+    bool inPrefix = true;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        Token token {kChar, c};
+        if (c == '\\' && i + 1 < pattern.size()) {
+            token.ch = pattern[++i];
+        } else if (c == '*') {
+            if (!_tokens.empty() && _tokens.back().op == kAnyString)
+                continue;       // `**` is the same as `*`
+            token.op = kAnyString;
+        } else if (c == '?') {
+            token.op = kAnyChar;
+        } else if (c == '[') {
+            // A set; `]` right after the `[` or `[!` is a member, not the end:
+            size_t j = i + 1;
+            bool negated = (j < pattern.size() && (pattern[j] == '!' || pattern[j] == '^'));
+            if (negated)
+                ++j;
+            bitset<256> set;
+            bool first = true;
+            int lastChar = -1;          // previous member, if a range can start with it
+            for (; j < pattern.size() && (first || pattern[j] != ']'); ++j, first = false) {
+                char m = pattern[j];
+                if (m == '\\' && j + 1 < pattern.size()) {
+                    m = pattern[++j];
+                } else if (m == '-' && lastChar >= 0 && j + 1 < pattern.size()
+                                    && pattern[j+1] != ']') {
+                    char hi = pattern[++j];
+                    if (hi == '\\' && j + 1 < pattern.size())
+                        hi = pattern[++j];
+                    for (unsigned ch = unsigned(lastChar); ch <= (unsigned char)hi; ++ch)
+                        set.set(ch);
+                    lastChar = -1;
+                    continue;
+                }
+                set.set((unsigned char)m);
+                lastChar = (unsigned char)m;
+            }
+            if (j < pattern.size()) {
+                if (negated)
+                    set.flip();
+                token.op = kSet;
+                token.set = unsigned(_sets.size());
+                _sets.push_back(set);
+                i = j;
+            }
+            // else an unterminated `[` is literal
+        }
+        if (token.op != kChar)
+            inPrefix = false;
+        else if (inPrefix)
+            _prefix += token.ch;
+        _tokens.push_back(token);
+    }
+}
+
+
+bool GlobMatcher::matchesChar(const Token &token, char c) const {
+    switch (token.op) {
+        case kChar:     return c == token.ch;
+        case kAnyChar:  return true;
+        case kSet:      return _sets[token.set].test((unsigned char)c);
+        default:        return false;
+    }
+}
+
+
+// Matches left to right, remembering the most recent `*`; on a mismatch it backtracks to make
+// that `*` consume one more character. (Earlier `*`s never need to be revisited.)
+bool GlobMatcher::matches(string_view str) const {
+    if (str.compare(0, _prefix.size(), _prefix) != 0)
+        return false;
+    size_t t = _prefix.size(), s = _prefix.size();
+    size_t starToken = string::npos, starPos = 0;
+    while (s < str.size()) {
+        if (t < _tokens.size()) {
+            const Token &token = _tokens[t];
+            if (token.op == kAnyString) {
+                starToken = t++;
+                starPos = s;
+                continue;
+            } else if (matchesChar(token, str[s])) {
+                ++t;
+                ++s;
+                continue;
+            }
+        }
+        if (starToken == string::npos)
+            return false;
+        t = starToken + 1;
+        s = ++starPos;
+    }
+    while (t < _tokens.size() && _tokens[t].op == kAnyString)
+        ++t;
+    return t == _tokens.size();
+}
+
+
+string GlobMatcher::prefixEnd() const {
+    string end = _prefix;
+    while (!end.empty() && (unsigned char)end.back() == 0xFF)
+        end.pop_back();
+    if (!end.empty())
+        end.back() = char((unsigned char)end.back() + 1);
+    return end;
+}
+
+
+bool GlobMatcher::isPrefixOnly() const {
+    return _tokens.size() == _prefix.size() + 1 && _tokens.back().op == kAnyString;
+}
@@ -0,0 +1,64 @@
+//
+// GlobMatcher.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include <bitset>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+/** A shell-style "glob" pattern, compiled once for matching many docIDs: `*` matches any number
+    of characters, `?` any single character, `[...]` one character of a set (`[!...]` or `[^...]`
+    one not in it), and `\` makes the next character literal. Matching doesn't allocate.
+
+    The pattern's literal prefix -- everything before the first wildcard -- bounds the range of
+    strings that can match, so an enumeration in sorted order can seek directly to that range
+    instead of testing every string. */
+class GlobMatcher {
+public:
+    explicit GlobMatcher(std::string_view pattern);
+
+    bool matches(std::string_view str) const;
+
+    /// The characters every match starts with.
+    const std::string& literalPrefix() const            {return _prefix;}
+
+    /// The smallest string greater than every string starting with the literal prefix, or an
+    /// empty string if there is no such bound.
+    std::string prefixEnd() const;
+
+    /// True if the pattern is just the literal prefix followed by `*`, so that every string in
+    /// the prefix's range matches.
+    bool isPrefixOnly() const;
+
+private:
+    enum Op : uint8_t {kChar, kAnyChar, kAnyString, kSet};
+
+    struct Token {
+        Op          op;
+        char        ch = 0;             // for kChar
+        unsigned    set = 0;            // for kSet: index into _sets
+    };
+
+    bool matchesChar(const Token&, char) const;
+
+    std::vector<Token>              _tokens;
+    std::vector<std::bitset<256>>   _sets;
+    std::string                     _prefix;
+};
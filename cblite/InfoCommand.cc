@@ -17,6 +17,7 @@
 //
 
 #include "CBLiteCommand.hh"
+#include "CollectionStats.hh"
 #include "c4Private.h"
 #include "fleece/Expert.hh"
 
@@ -24,7 +25,6 @@
 #include "c4Database.hh"
 #include <iomanip>
 #include <array>
-#include <bit>
 
 using namespace fleece;
 using namespace std;
@@ -73,6 +73,16 @@ private:
 };
 
 
+static ostream& operator<<(ostream& out, const CollectionStats& stats) {
+    return out << setw(8) << stats.count << ' '
+               << setw(8) << stats.deletedCount << ' '
+               << setw(8) << stats.withAttachmentCount << ' '
+               << setw(8) << stats.conflictCount << ' '
+               << setw(10) << stats.dataSize << ' '
+               << setw(10) << stats.metaSize;
+}
+
+
 class InfoCommand : public CBLiteCommand {
 public:
     string arg;
@@ -87,7 +97,10 @@ public:
         writeUsageCommand("info", false);
         cerr <<
         "  Displays information about the database, like sizes and counts.\n"
-        "    --verbose or -v : Gives more detail. Twice, gives even more detail.\n";
+        "    --verbose or -v : Gives more detail. Twice, gives even more detail.\n"
+        "    --rescan : Scans every document for -v statistics, instead of only the ones changed\n"
+        "               since they were last computed\n"
+        "    --save-stats : Saves the -v statistics in the database even if it's opened read-only\n";
         writeUsageCommand("info", false, "indexes");
         cerr <<
         "  Lists all indexes and the values they index.\n";
@@ -105,6 +118,8 @@ public:
         processFlags({
             {"--verbose", [&]{verboseFlag();}},
             {"-v",        [&]{verboseFlag();}},
+            {"--rescan",  [&]{_rescan = true;}},
+            {"--save-stats", [&]{_saveStats = true;}},
         });
 
         void (InfoCommand::*subSubCommand)() = &InfoCommand::generalInfo;
@@ -183,16 +198,21 @@ public:
             cout.flush();
             auto collections = allCollections();
             if (verbose()) {
+                CollectionStatsScanner scanner(_db, collections);
+                scanner.setUseCache(!_rescan);
+                scanner.setSaveCache(_saveStats);
+                vector<CollectionStats> allStats = scanner.run();
+
                 CollectionStats totalStats;
                 cout << ansiUnderline() << "       Name      #Docs     #Del   #Blobs   #Confl  Body Size  Meta Size" << ansiReset() << endl;
-                for (CollectionName& spec : collections) {
-                    cout << setw(24) << nameOfCollection(spec) << " : ";
-                    cout.flush();
-                    auto stats = getCollectionStats(spec);
-                    cout << stats << endl;
-                    totalStats += stats;
+                for (size_t i = 0; i < collections.size(); ++i) {
+                    cout << setw(24) << nameOfCollection(collections[i]) << " : " << allStats[i] << endl;
+                    totalStats += allStats[i];
                 }
                 cout << ansiBold() << setw(24) << "TOTALS" << " : " << totalStats << ansiReset() << endl;
+                if (scanner.docsScanned() < totalStats.count)
+                    cout << ansiDim() << "             (" << scanner.docsScanned() << " of " << totalStats.count
+                         << " docs scanned; the rest were unchanged since last time)" << ansiReset() << endl;
 
                 if (verbose() >= 2) {
                     cout << "Document size distribution:\n";
@@ -310,54 +330,6 @@ public:
     }
 
 
-    struct CollectionStats {
-        uint64_t count= 0, deletedCount = 0, withAttachmentCount = 0, conflictCount = 0;
-        uint64_t dataSize = 0, metaSize = 0;
-        array<uint64_t,24> sizeHistogram = {}; // indexed by log2(dataSize+metaSize)
-
-        CollectionStats& operator+=(const CollectionStats& other) {
-            count += other.count;
-            dataSize += other.dataSize;
-            metaSize += other.metaSize;
-            deletedCount += other.deletedCount;
-            conflictCount += other.conflictCount;
-            withAttachmentCount += other.withAttachmentCount;
-            for (size_t i = 0; i < std::size(sizeHistogram); ++i)
-                sizeHistogram[i] += other.sizeHistogram[i];
-            return *this;
-        }
-
-        friend ostream& operator<<(ostream& out, const CollectionStats& stats) {
-            return out << setw(8) << stats.count << ' '
-                       << setw(8) << stats.deletedCount << ' '
-                       << setw(8) << stats.withAttachmentCount << ' '
-                       << setw(8) << stats.conflictCount << ' '
-                       << setw(10) << stats.dataSize << ' '
-                       << setw(10) << stats.metaSize;
-        }
-    };
-
-
-    CollectionStats getCollectionStats(C4CollectionSpec const& spec) {
-        CollectionStats stats;
-        EnumerateDocsOptions options;
-        options.collection = _db->getCollection(spec);
-        options.flags |= kC4Unsorted | kC4IncludeDeleted;
-        enumerateDocs(options, [&](const C4DocumentInfo &info, C4Document *doc) {
-            stats.count++;
-            if (info.flags & kDocDeleted)        ++stats.deletedCount;
-            if (info.flags & kDocHasAttachments) ++stats.withAttachmentCount;
-            if (info.flags & kDocConflicted)     ++stats.conflictCount;
-            stats.dataSize += info.bodySize;
-            stats.metaSize += info.metaSize;
-
-            auto i = std::min(64 - countl_zero(info.bodySize), 23);
-            stats.sizeHistogram[i]++;
-        });
-        return stats;
-    }
-
-
     fleece::Doc sharedKeysDoc() {
         auto sk = c4db_getFLSharedKeys(_db);
         FLSharedKeys_Decode(sk, 0);
@@ -405,6 +377,10 @@ public:
         Doc result(fleeceResult);
         return result.asArray()[0].asArray()[0].asInt();
     }
+
+private:
+    bool _rescan = false;
+    bool _saveStats = false;
 };
 
 
@@ -0,0 +1,274 @@
+//
+// InterruptibleQuery.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "InterruptibleQuery.hh"
+#include <condition_variable>
+#include <csignal>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+using namespace fleece;
+
+
+static volatile sig_atomic_t sInterrupted = 0;
+
+
+InterruptHandler::InterruptHandler() {
+    sInterrupted = 0;
+    _previous = signal(SIGINT, [](int) {sInterrupted = 1;});
+}
+
+
+InterruptHandler::~InterruptHandler() {
+    signal(SIGINT, _previous);
+}
+
+
+bool InterruptHandler::interrupted() {
+    return sInterrupted != 0;
+}
+
+
+// How long the destructor waits for the thread to finish, before leaving it to finish later:
+static constexpr auto kJoinTimeout = chrono::seconds(1);
+
+// How long the process waits at exit for abandoned threads to finish:
+static constexpr auto kExitJoinTimeout = chrono::seconds(5);
+
+// Number of pages a paged query is run in, at most; then the rest is run at once. Re-running the
+// query for each page costs more the further it gets, and by then the first rows are out.
+static constexpr unsigned kMaxPages = 8;
+
+
+// Everything the background thread uses. It's shared, since an abandoned thread outlives the
+// InterruptibleQuery.
+struct InterruptibleQuery::State {
+    c4::ref<C4Database>                 db;
+    c4::ref<C4Query>                    query;
+    alloc_slice                         params;
+    Options                             options;
+    shared_ptr<atomic<bool>>            busy;
+    BoundedQueue<Row>                   queue {1024};
+    C4Error                             error {};   // Set before the queue is closed
+    mutex                               doneMutex;
+    condition_variable                  doneCond;
+    bool                                done = false;
+
+    // Waits up to `timeout` for the thread to finish; returns true if it has.
+    bool waitDone(chrono::steady_clock::duration timeout) {
+        unique_lock<mutex> lock(doneMutex);
+        return doneCond.wait_for(lock, timeout, [&] {return done;});
+    }
+};
+
+
+// The threads of queries that were still running when their InterruptibleQuery was destroyed.
+// Each is joined after its query finishes: when another InterruptibleQuery is created, or at the
+// latest when the process exits.
+class AbandonedThreads {
+public:
+    void add(thread t, function<bool(chrono::steady_clock::duration)> waitDone) {
+        lock_guard<mutex> lock(_mutex);
+        _threads.push_back({std::move(t), std::move(waitDone)});
+    }
+
+    void joinFinished() {
+        lock_guard<mutex> lock(_mutex);
+        for (auto i = _threads.begin(); i != _threads.end();) {
+            if (i->waitDone(chrono::steady_clock::duration::zero())) {
+                i->thread.join();
+                i = _threads.erase(i);
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    ~AbandonedThreads() {
+        auto deadline = chrono::steady_clock::now() + kExitJoinTimeout;
+        for (auto &t : _threads) {
+            if (t.waitDone(max(deadline - chrono::steady_clock::now(),
+                               chrono::steady_clock::duration::zero())))
+                t.thread.join();
+            else
+                t.thread.detach();  // Don't hold up the exit until a runaway query finishes
+        }
+    }
+
+private:
+    struct Entry {
+        std::thread                                         thread;
+        function<bool(chrono::steady_clock::duration)>      waitDone;
+    };
+    mutex           _mutex;
+    vector<Entry>   _threads;
+};
+
+static AbandonedThreads sAbandonedThreads;
+
+
+void InterruptibleQuery::joinFinishedThreads() {
+    sAbandonedThreads.joinFinished();
+}
+
+
+InterruptibleQuery::InterruptibleQuery(c4::ref<C4Database> connection,
+                                       c4::ref<C4Query> query,
+                                       alloc_slice params,
+                                       Options options,
+                                       shared_ptr<atomic<bool>> busy)
+:_state(make_shared<State>())
+{
+    _state->db = std::move(connection);
+    _state->query = std::move(query);
+    _state->params = std::move(params);
+    _state->options = options;
+    _state->busy = std::move(busy);
+    joinFinishedThreads();
+    if (_state->busy)
+        *_state->busy = true;
+    if (options.timeout)
+        _deadline = chrono::steady_clock::now()
+                  + chrono::duration_cast<chrono::steady_clock::duration>(
+                                                    chrono::duration<double>(*options.timeout));
+    _thread = thread([state = _state] { run(*state); });
+}
+
+
+InterruptibleQuery::~InterruptibleQuery() {
+    _state->queue.close();
+    // If it's still inside c4query_run, it can't be stopped; it's joined once it finishes:
+    if (_state->waitDone(kJoinTimeout))
+        _thread.join();
+    else
+        sAbandonedThreads.add(std::move(_thread), [state = _state](auto timeout) {
+            return state->waitDone(timeout);
+        });
+}
+
+
+Array::iterator InterruptibleQuery::columns() const {
+    return Array::iterator(_current.doc.asArray());
+}
+
+
+bool InterruptibleQuery::next() {
+    while (!_interruption) {
+        if (InterruptHandler::interrupted())
+            _interruption = "was interrupted";
+        else if (_state->options.timeout && chrono::steady_clock::now() >= _deadline)
+            _interruption = "timed out";
+        else {
+            bool timedOut;
+            optional<Row> row = _state->queue.popFor(chrono::milliseconds(100), &timedOut);
+            if (row) {
+                _current = std::move(*row);
+                return true;
+            } else if (!timedOut) {
+                // The thread finished:
+                if (_state->error.code)
+                    LiteCoreTool::instance()->fail("running query", _state->error);
+                return false;
+            }
+        }
+    }
+
+    // Stop the thread, but return the rows it already produced:
+    _state->queue.close();
+    optional<Row> row = _state->queue.pop();
+    if (!row)
+        return false;
+    _current = std::move(*row);
+    return true;
+}
+
+
+void InterruptibleQuery::run(State &state) {
+    const Options &options = state.options;
+    uint64_t offset = options.offset;
+    int64_t remaining = options.limit;
+    int64_t pageSize = 1000;
+    unsigned nPages = 0;
+    Encoder enc;
+    bool stopped = false;
+    while (!stopped) {
+        alloc_slice params = state.params;
+        int64_t pageLimit = -1;
+        if (options.paged) {
+            if (++nPages < kMaxPages)
+                pageLimit = (remaining >= 0) ? min(remaining, pageSize) : pageSize;
+            else
+                pageLimit = remaining;          // The last page gets all the rest
+            params = pageParams(state.params, offset, pageLimit);
+        }
+
+        c4::ref<C4QueryEnumerator> e = c4query_run(state.query, params, &state.error);
+        if (!e)
+            break;
+        int64_t nRows = 0;
+        while (c4queryenum_next(e, &state.error)) {
+            enc.beginArray();
+            for (Array::iterator i(e->columns); i; ++i)
+                enc.writeValue(i.value());
+            enc.endArray();
+            if (!state.queue.push(Row{enc.finishDoc(), e->missingColumns})) {
+                stopped = true;     // Abandoned
+                break;
+            }
+            ++nRows;
+        }
+        if (state.error.code || !options.paged || pageLimit < 0 || nRows < pageLimit)
+            break;
+        offset += nRows;
+        if (remaining >= 0 && (remaining -= nRows) == 0)
+            break;
+        // Each page re-runs the query, so grow them to keep the total cost proportional:
+        pageSize = min(pageSize * 2, int64_t(1) << 20);
+    }
+    state.queue.close();
+    if (state.busy)
+        *state.busy = false;
+    lock_guard<mutex> lock(state.doneMutex);
+    state.done = true;
+    state.doneCond.notify_all();
+}
+
+
+// Returns `params` (a JSON object, or null) with its `offset` and `limit` replaced. A negative
+// `limit` means no limit.
+alloc_slice InterruptibleQuery::pageParams(slice params, uint64_t offset, int64_t limit) {
+    JSONEncoder enc;
+    enc.beginDict();
+    if (params) {
+        Doc doc = Doc::fromJSON(params, nullptr);
+        for (Dict::iterator i(doc.asDict()); i; ++i) {
+            if (i.keyString() != "offset"_sl && i.keyString() != "limit"_sl) {
+                enc.writeKey(i.keyString());
+                enc.writeValue(i.value());
+            }
+        }
+    }
+    enc.writeKey("offset"_sl);
+    enc.writeUInt(offset);
+    enc.writeKey("limit"_sl);
+    enc.writeInt(limit >= 0 ? limit : INT64_MAX);
+    enc.endDict();
+    return enc.finish();
+}
@@ -0,0 +1,95 @@
+//
+// InterruptibleQuery.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "QueryRows.hh"
+#include "Parallel.hh"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <thread>
+
+
+/** While an instance exists, Ctrl-C (SIGINT) sets a flag instead of killing the process. */
+class InterruptHandler {
+public:
+    InterruptHandler();
+    ~InterruptHandler();
+
+    /// True if Ctrl-C was pressed since the innermost handler was installed.
+    static bool interrupted();
+
+private:
+    void (*_previous)(int);
+};
+
+
+/** Runs a query on a background thread, returning rows as it produces them, so that waiting for
+    it can be abandoned when it times out or the user presses Ctrl-C; the rows produced until
+    then are still returned.
+
+    LiteCore can't stop a query that's running, so an abandoned thread runs it to the end by
+    itself before exiting. That's why it needs a database connection of its own. To get partial
+    results out of a long query, a "paged" query (which must end with `LIMIT $limit OFFSET
+    $offset`) is run in a series of pages of increasing size, then the rest at once. Each page
+    is a separate run of the query, so if the database changes in between, the results aren't a
+    consistent snapshot: rows may be skipped or repeated. */
+class InterruptibleQuery : public QueryRows {
+public:
+    struct Options {
+        std::optional<double>   timeout;        // Seconds
+        bool                    paged = false;
+        uint64_t                offset = 0;     // Used for paging
+        int64_t                 limit = -1;     // Used for paging
+    };
+
+    /// Starts running the query, which must have been compiled on `connection`.
+    /// If `busy` is given, it's set until the thread stops using the connection.
+    InterruptibleQuery(c4::ref<C4Database> connection,
+                       c4::ref<C4Query> query,
+                       fleece::alloc_slice params,
+                       Options options,
+                       std::shared_ptr<std::atomic<bool>> busy = nullptr);
+
+    ~InterruptibleQuery();
+
+    bool next() override;
+    fleece::Array::iterator columns() const override;
+    uint64_t missingColumns() const override                {return _current.missing;}
+
+    /// If the results are incomplete, describes why, e.g. "timed out"; else returns nullptr.
+    const char* interruption() const                        {return _interruption;}
+
+private:
+    struct Row {
+        fleece::Doc doc;                // Fleece array of column values
+        uint64_t    missing = 0;
+    };
+    struct State;
+
+    static void run(State&);
+    static void joinFinishedThreads();
+    static fleece::alloc_slice pageParams(fleece::slice params, uint64_t offset, int64_t limit);
+
+    std::shared_ptr<State>                  _state;
+    std::thread                             _thread;
+    std::chrono::steady_clock::time_point   _deadline;
+    Row                                     _current;
+    const char*                             _interruption = nullptr;
+};
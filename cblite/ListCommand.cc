@@ -17,9 +17,9 @@
 //
 
 #include "ListCommand.hh"
+#include "Parallel.hh"
 #include "c4Collection.hh"
 #include "c4Database.hh"
-#include <iomanip>
 
 using namespace std;
 using namespace litecore;
@@ -41,6 +41,7 @@ void ListCommand::usage() {
         "    -l : Long format (one doc per line, with metadata)\n"
         "    --offset N : Skip first N docs\n"
         "    --limit N  : Stop after N docs\n"
+        "    --after ID : Start after this docID (or sequence, with --seq)\n"
         "    --desc     : Descending order\n"
         "    --seq      : Order by sequence, not docID\n"
         "    --del      : Include deleted documents\n"
@@ -61,6 +62,7 @@ void ListCommand::runSubcommand() {
         processFlags({
             {"--offset", [&]{offsetFlag();}},
             {"--limit",  [&]{limitFlag();}},
+            {"--after",  [&]{_after = nextArg("docID or sequence");}},
             {"-l",       [&]{_longListing = true;}},
             {"--body",   [&]{bodyFlag();}},
             {"--pretty", [&]{_prettyPrint = true;}},  // note: it's true by default
@@ -94,9 +96,11 @@ void ListCommand::listDocs(string docIDPattern) {
     options.offset      = _offset;
     options.limit       = _limit;
     options.pattern     = docIDPattern;
+    options.after       = _after;
 
+    OutputSink &out = OutputSink::console();
     if (_offset > 0)
-        cout << "(Skipping first " << _offset << " docs)\n";
+        out << "(Skipping first " << _offset << " docs)\n";
 
     int xpos = 0;
     int lineWidth = terminalWidth();
@@ -107,12 +111,14 @@ void ListCommand::listDocs(string docIDPattern) {
         revIDWidth = _prettyPrint ? 15 : (3+1+40);
 
     bool firstDoc = true;
+    string cursor;
     int64_t nDocs = enumerateDocs(options, [&](const C4DocumentInfo &info, C4Document *doc) {
+        cursor = _listBySeq ? to_string(uint64_t(info.sequence)) : string(slice(info.docID));
         int idWidth = (int)info.docID.size;        //TODO: Account for UTF-8 chars
         if (_enumFlags & kC4IncludeBodies) {
             // 'cat' form:
             if (!firstDoc)
-                cout << "\n";
+                out << '\n';
 
             firstDoc = false;
             catDoc(doc, true);
@@ -121,11 +127,11 @@ void ListCommand::listDocs(string docIDPattern) {
             // Long form:
             if (firstDoc) {
                 firstDoc = false;
-                cout << ansi("4") << "Document ID             "
-                     << setw(revIDWidth) << left << "Rev ID" << right << "  Flags   Seq     Size"
-                     << ansiReset() << "\n";
+                out << out.underline() << "Document ID             ";
+                out.writePadded("Rev ID", revIDWidth);
+                out << "  Flags   Seq     Size" << out.reset() << '\n';
             } else {
-                cout << "\n";
+                out << '\n';
             }
 
             string revID = formatRevID(info.revID, _prettyPrint);
@@ -134,14 +140,17 @@ void ListCommand::listDocs(string docIDPattern) {
             else
                 revID.resize(revIDWidth, ' ');
 
-            cout << info.docID << spaces(kListColumnWidth - idWidth);
-            cout << revID << "  ";
-            cout << ((info.flags & kDocDeleted)        ? 'd' : '-');
-            cout << ((info.flags & kDocConflicted)     ? 'c' : '-');
-            cout << ((info.flags & kDocHasAttachments) ? 'a' : '-');
-            cout << ' ';
-            cout << setw(7) << info.sequence << " ";
-            cout << setw(7) << setprecision(1) << (info.bodySize / 1024.0) << 'K';
+            out << slice(info.docID);
+            out.pad(std::max(kListColumnWidth - idWidth, 0));
+            out << revID << "  ";
+            out << ((info.flags & kDocDeleted)        ? 'd' : '-');
+            out << ((info.flags & kDocConflicted)     ? 'c' : '-');
+            out << ((info.flags & kDocHasAttachments) ? 'a' : '-');
+            out << ' ';
+            out.writeUInt(info.sequence, 7);
+            out << ' ';
+            out.writeDouble(info.bodySize / 1024.0, 7, 1);
+            out << 'K';
 
         } else {
             // Short form:
@@ -149,30 +158,31 @@ void ListCommand::listDocs(string docIDPattern) {
             int newXpos = xpos + nSpaces + idWidth;
             if (newXpos < lineWidth) {
                 if (xpos > 0)
-                    cout << spaces(nSpaces);
+                    out.pad(nSpaces);
                 xpos = newXpos;
             } else {
-                cout << "\n";
+                out << '\n';
                 xpos = idWidth;
             }
-            cout << info.docID;
+            out << slice(info.docID);
         }
     });
 
     if (nDocs == 0) {
         if (docIDPattern.empty())
-            cout << "(No documents";
+            out << "(No documents";
         else if (isGlobPattern(docIDPattern))
-            cout << "(No documents with IDs matching \"" << docIDPattern << "\"";
+            out << "(No documents with IDs matching \"" << docIDPattern << '"';
         else
-            cout << "(Document \"" << docIDPattern << "\" not found";
+            out << "(Document \"" << docIDPattern << "\" not found";
         if (!_collectionName.empty())
-            cout << " in collection \"" << _collectionName << "\"";
-        cout << ")";
+            out << " in collection \"" << _collectionName << '"';
+        out << ')';
     } else if (nDocs > _limit && _limit > 0) {
-        cout << "\n(Stopping after " << _limit << " docs)";
+        out << "\n(Stopping after " << _limit << " docs; next page: --after " << cursor << ')';
     }
-    cout << "\n";
+    out << '\n';
+    out.flush();
 }
 
 
@@ -185,46 +195,98 @@ void ListCommand::catDoc(C4Document *doc, bool includeID) {
         docID = slice(doc->docID);
     if (_showRevID)
         revID = (slice)doc->selectedRev.revID;
+    OutputSink &out = OutputSink::console();
     if (_prettyPrint)
-        prettyPrint(body, cout, "", docID, revID, (_keys.empty() ? nullptr : &_keys));
+        prettyPrint(body, out, "", docID, revID, (_keys.empty() ? nullptr : &_keys));
     else
-        rawPrint(body, docID, revID);
+        rawPrint(body, out, docID, revID);
 }
 
 
-void ListCommand::listCollections() {
-    vector<CollectionName> specs = allCollections();
-    int nameWidth = 10;
-    for (auto& spec : specs)
-        nameWidth = std::max(nameWidth, int(nameOfCollection(spec).size()));
+// Counts a collection's live, deleted and expiring docs in one pass over their metadata.
+static ListCommand::CollectionCounts countCollection(C4Collection *coll) {
+    ListCommand::CollectionCounts counts;
+    C4Error error;
+    C4EnumeratorOptions options = {kC4IncludeNonConflicted | kC4IncludeDeleted | kC4Unsorted};
+    c4::ref<C4DocEnumerator> e = c4coll_enumerateAllDocs(coll, &options, &error);
+    if (!e)
+        LiteCoreTool::instance()->fail("creating enumerator", error);
+    while (c4enum_next(e, &error)) {
+        C4DocumentInfo info;
+        c4enum_getDocumentInfo(e, &info);
+        if (info.flags & kDocDeleted) {
+            ++counts.deleted;
+        } else {
+            ++counts.live;
+            if (info.expiration > 0)
+                ++counts.expiring;
+        }
+    }
+    if (error.code)
+        LiteCoreTool::instance()->fail("enumerating documents", error);
+    return counts;
+}
 
-    cout << ansi("4") << left << setw(nameWidth) << "Collection";
-    cout << "     Docs  Deleted  Expiring" << ansiReset() << "\n";
 
-    for (auto const& spec : specs) {
-        string fullName = nameOfCollection(spec);
-        cout << ansiBold() << left << setw(nameWidth) << fullName << ansiReset() << "  ";
-        cout.flush(); // the next results may take a few seconds to print
+// Counts the docs of each collection. Collections are counted concurrently, each on a read-only
+// connection of its own.
+vector<ListCommand::CollectionCounts> ListCommand::countCollections(const vector<CollectionName> &specs) {
+    vector<CollectionCounts> counts(specs.size());
+    auto nWorkers = unsigned(std::min(size_t(defaultParallelism()), specs.size()));
+    if (nWorkers <= 1) {
+        for (size_t i = 0; i < specs.size(); ++i)
+            counts[i] = countCollection(_db->getCollection(C4CollectionSpec(specs[i])));
+        return counts;
+    }
 
-        auto coll = _db->getCollection(C4CollectionSpec(spec));
-        auto docCount = coll->getDocumentCount();
-        cout << right << setw(7) << docCount << "  ";
+    ConnectionPool<> connections;
+    C4Error openError;
+    if (!addReadOnlyConnections(connections, _db, nWorkers, &openError))
+        fail("opening another connection to the database", openError);
+
+    parallelFor(specs.size(), nWorkers, [&](size_t i) {
+        auto conn = connections.acquire();
+        C4Error error;
+        C4Collection *coll = c4db_getCollection(*conn, C4CollectionSpec(specs[i]), &error);
+        if (!coll)
+            fail("opening collection " + nameOfCollection(specs[i]), error);
+        counts[i] = countCollection(coll);
+    });
+    return counts;
+}
 
-        auto nDeletedDocs = countDocsWhere(spec, "_deleted");
-        cout << setw(7) << nDeletedDocs << "  ";
 
-//        cout << setw(7) << coll->getLastSequence() << "  ";
+void ListCommand::listCollections() {
+    vector<CollectionName> specs = allCollections();
+    int nameWidth = 10;
+    for (auto& spec : specs)
+        nameWidth = std::max(nameWidth, int(nameOfCollection(spec).size()));
 
-        C4Timestamp nextExpiration = coll->nextDocExpiration();
-        if (nextExpiration > 0) {
-            cout << setw(8) << countDocsWhere(spec, "_expiration > 0");
+    vector<CollectionCounts> counts = countCollections(specs);
+
+    OutputSink &out = OutputSink::console();
+    out << out.underline();
+    out.writePadded("Collection", nameWidth);
+    out << "     Docs  Deleted  Expiring" << out.reset() << '\n';
+
+    for (size_t i = 0; i < specs.size(); ++i) {
+        out << out.bold();
+        out.writePadded(nameOfCollection(specs[i]), nameWidth);
+        out << out.reset() << "  ";
+        out.writeUInt(counts[i].live, 7);
+        out << "  ";
+        out.writeUInt(counts[i].deleted, 7);
+        out << "  ";
+        out.writeUInt(counts[i].expiring, 8);
+
+        auto coll = _db->getCollection(C4CollectionSpec(specs[i]));
+        if (C4Timestamp nextExpiration = coll->nextDocExpiration(); nextExpiration > 0) {
             auto when = std::max((long long)nextExpiration - c4_now(), 0ll);
-            cout << ansiItalic() << " (next in " << when << " sec)" << ansiReset();
-        } else {
-            cout << setw(8) << 0;
+            out << out.italic() << " (next in " << when << " sec)" << out.reset();
         }
-        cout << endl;
+        out << '\n';
     }
+    out.flush();
 }
 
 
@@ -21,6 +21,12 @@ public:
     void runSubcommand() override;
 
 
+    /// Document counts of a collection, as shown by `lscoll`.
+    struct CollectionCounts {
+        uint64_t live = 0, deleted = 0, expiring = 0;
+    };
+
+
     void addLineCompletions(ArgumentTokenizer &tokenizer,
                             std::function<void(const std::string&)> add) override
     {
@@ -30,10 +36,12 @@ public:
 protected:
     void listDocs(std::string docIDPattern);
     void listCollections();
+    std::vector<CollectionCounts> countCollections(const std::vector<CollectionName>&);
     void catDoc(C4Document *doc, bool includeID);
     
     bool    _showRevID {false};
     bool    _longListing {false};
     bool    _listBySeq {false};
     bool    _listCollections {false};
+    std::string _after;
 };
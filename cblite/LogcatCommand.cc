@@ -100,11 +100,10 @@ public:
             _full = false;
 
         if (_outputFile.empty()) {
-            writeLog(cout);
+            writeLog(OutputSink::console());
+            OutputSink::console().flush();
         } else {
-            ofstream out(_outputFile, ofstream::trunc);
-            if (!out)
-                fail("Couldn't open output file " + _outputFile);
+            OutputSink out(_outputFile);
             writeLog(out);
         }
     }
@@ -143,14 +142,13 @@ public:
     }
 
 
-    void writeLog(ostream &out) {
+    void writeLog(OutputSink &out) {
+        // The styles are empty when writing to a file or a pipe:
         array<string, 5> levels = {"d", "v", "I", "W", "E"};
-        if (_outputFile.empty()) {
-            levels[0] = ansiDim() + levels[0];
-            levels[1] = ansiDim() + levels[1];
-            levels[3] = ansiBold() + ansiRed() + levels[3] + ansiReset();
-            levels[4] = ansiBold() + ansiRed() + levels[4] + ansiReset();
-        }
+        levels[0] = out.dim() + levels[0];
+        levels[1] = out.dim() + levels[1];
+        levels[3] = out.bold() + out.red() + levels[3] + out.reset();
+        levels[4] = out.bold() + out.red() + levels[4] + out.reset();
 
         _startTime = _decoder.startTime();
         if (_full)
@@ -159,7 +157,7 @@ public:
         if (_csv)
             out << "Time,Level,Domain,Object,Message\r\n";
 
-        string highlightedStr = ansi("43") + _highlight + ansi("49");  // yellow bg
+        string highlightedStr = out.ansi("43") + _highlight + out.ansi("49");  // yellow bg
         if (highlightedStr == _highlight)
             highlightedStr = "▶︎▶︎" + _highlight + "◀︎◀︎";  // fallback without ANSI color
 
@@ -180,24 +178,29 @@ public:
                     out << int(level);
                 out << ',' << _decoder.domain() << ',';
                 if (auto desc = _decoder.objectDescription())
-                    out << quoted(*desc);
-                out << "," << quoted(_decoder.readMessage()) << "\r\n";
+                    out.stream() << quoted(*desc);
+                out << ',';
+                out.stream() << quoted(_decoder.readMessage());
+                out << "\r\n";
 
             } else {
                 // Line number:
-                out << ansiDim();
-                if (_lineNumbers)
-                    out << setw(5) << right << _lineNo << ' ';
+                out << out.dim();
+                if (_lineNumbers) {
+                    out.writeUInt(_lineNo, 5);
+                    out << ' ';
+                }
 
                 // Timestamp:
                 writeTimestamp(_decoder.timestamp(), out);
-                out << ansiReset() << ' ';
+                out << out.reset() << ' ';
 
                 // Level:
-                string levelName;
                 if (auto level = _decoder.level(); level >= 0 && level < levels.size())
-                    levelName = levels[level];
-                out << levelName << ' ' << setw(6) << left << _decoder.domain() << "⏐ ";
+                    out << levels[level];
+                out << ' ';
+                out.writePadded(_decoder.domain(), 6);
+                out << "⏐ ";
 
                 // Object ID:
                 if (auto objID = _decoder.objectID()) {
@@ -212,17 +215,17 @@ public:
                         objName = i->second;
                     }
 
-                    out << ansiItalic() << "⟦";
+                    out << out.italic() << "⟦";
                     if (objName == _highlight)
                         out << highlightedStr;
                     else
                         out << objName;
-                    out << "⟧ " << ansiNoItalic();
+                    out << "⟧ " << out.noItalic();
                 }
 
                 // Log message:
                 if (_highlight.empty()) {
-                    _decoder.decodeMessageTo(out);
+                    _decoder.decodeMessageTo(out.stream());
                 } else {
                     string message = _decoder.readMessage();
                     string_view messagev = message;
@@ -234,7 +237,7 @@ public:
                     }
                     out << messagev.substr(lastPos);
                 }
-                out << ansiReset() << '\n';
+                out << out.reset() << '\n';
             }
         }
     }
@@ -264,7 +267,7 @@ public:
     }
 
 
-    void writeTimestamp(LogDecoder::Timestamp t, ostream& out) {
+    void writeTimestamp(LogDecoder::Timestamp t, OutputSink& out) {
         if (_relativeTime) {
             t.secs -= _startTime.secs;
             if (int micro = int(t.microsecs) - int(_startTime.microsecs); micro >= 0) {
@@ -276,7 +279,7 @@ public:
             out << stringprintf("%02ld:%02ld:%02ld.%06u",
                 t.secs / 3600, (t.secs % 3600) / 60, t.secs % 60, t.microsecs);
         } else {
-            LogIterator::writeISO8601DateTime(t, out);
+            LogIterator::writeISO8601DateTime(t, out.stream());
         }
     }
 
@@ -175,6 +175,7 @@ public:
             cout << endl;
             fail("Couldn't create index", error);
         }
+        invalidateQueryCache();
 
         cout << " Done!\n";
     }
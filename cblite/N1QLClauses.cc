@@ -0,0 +1,393 @@
+//
+// N1QLClauses.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "N1QLClauses.hh"
+#include <cctype>
+#include <cstring>
+#include <regex>
+#include <set>
+
+using namespace std;
+
+
+namespace {
+
+    // Clauses in the order they must appear:
+    enum Clause {kSelect, kFrom, kWhere, kGroupBy, kHaving, kOrderBy, kLimit, kOffset, kNone};
+
+    struct Marker {
+        Clause clause;
+        size_t start;       // Position of the keyword
+        size_t bodyStart;   // Position after the keyword
+    };
+
+
+    bool isIdentifierChar(char c) {
+        return isalnum((unsigned char)c) || c == '_' || c == '$' || c == '.';
+    }
+
+
+    string trim(const string &str) {
+        auto start = str.find_first_not_of(" \t\r\n");
+        if (start == string::npos)
+            return "";
+        auto end = str.find_last_not_of(" \t\r\n");
+        return str.substr(start, end - start + 1);
+    }
+
+
+    string upper(string str) {
+        for (auto &c : str)
+            c = char(toupper((unsigned char)c));
+        return str;
+    }
+
+
+    // Calls `fn(pos)` for every character of `str` that's at the top level, i.e. not inside
+    // parentheses, brackets, braces, or quotes.
+    template <class FN>
+    void forEachTopLevelChar(const string &str, FN fn) {
+        char quote = 0;
+        bool escaped = false;
+        int depth = 0;
+        for (size_t i = 0; i < str.size(); ++i) {
+            char c = str[i];
+            if (quote) {
+                if (escaped)
+                    escaped = false;
+                else if (c == '\\')
+                    escaped = true;
+                else if (c == quote)
+                    quote = 0;
+            } else if (c == '\'' || c == '"' || c == '`') {
+                quote = c;
+            } else if (c == '(' || c == '[' || c == '{') {
+                ++depth;
+            } else if (c == ')' || c == ']' || c == '}') {
+                --depth;
+            } else if (depth == 0) {
+                fn(i);
+            }
+        }
+    }
+
+
+    // Removes backquotes around an identifier.
+    string unquote(const string &str) {
+        if (str.size() >= 2 && str.front() == '`' && str.back() == '`')
+            return str.substr(1, str.size() - 2);
+        return str;
+    }
+
+
+    // If `str` ends with `word` (case-insensitively) as a separate word, removes it.
+    bool removeSuffixWord(string &str, const char *word) {
+        size_t len = strlen(word);
+        if (str.size() <= len || upper(str.substr(str.size() - len)) != word
+                || !isspace((unsigned char)str[str.size() - len - 1]))
+            return false;
+        str = trim(str.substr(0, str.size() - len));
+        return true;
+    }
+
+}
+
+
+optional<N1QLClauses> N1QLClauses::parse(const string &queryStr) {
+    string query = trim(queryStr);
+    if (!query.empty() && query.back() == ';')
+        query = trim(query.substr(0, query.size() - 1));
+
+    // Find the clause keywords:
+    vector<Marker> markers;
+    forEachTopLevelChar(query, [&](size_t i) {
+        if (!isalpha((unsigned char)query[i]) || (i > 0 && isIdentifierChar(query[i-1])))
+            return;
+        size_t end = i;
+        while (end < query.size() && isIdentifierChar(query[end]))
+            ++end;
+        string word = upper(query.substr(i, end - i));
+        Clause clause = kNone;
+        if (word == "SELECT")       clause = kSelect;
+        else if (word == "FROM")    clause = kFrom;
+        else if (word == "WHERE")   clause = kWhere;
+        else if (word == "HAVING")  clause = kHaving;
+        else if (word == "LIMIT")   clause = kLimit;
+        else if (word == "OFFSET")  clause = kOffset;
+        else if (word == "GROUP" || word == "ORDER") {
+            // Must be followed by BY:
+            size_t by = end;
+            while (by < query.size() && isspace((unsigned char)query[by]))
+                ++by;
+            if (by > end && upper(query.substr(by, 2)) == "BY"
+                         && (by + 2 == query.size() || !isIdentifierChar(query[by + 2]))) {
+                clause = (word == "GROUP") ? kGroupBy : kOrderBy;
+                end = by + 2;
+            }
+        }
+        if (clause != kNone)
+            markers.push_back({clause, i, end});
+    });
+
+    if (markers.empty() || markers[0].clause != kSelect || markers[0].start != 0)
+        return nullopt;
+    for (size_t m = 1; m < markers.size(); ++m) {
+        Clause prev = markers[m-1].clause, cur = markers[m].clause;
+        bool limitOffset = (prev == kLimit && cur == kOffset) || (prev == kOffset && cur == kLimit);
+        if (cur <= prev && !limitOffset)
+            return nullopt;
+    }
+
+    N1QLClauses result;
+    for (size_t m = 0; m < markers.size(); ++m) {
+        size_t end = (m + 1 < markers.size()) ? markers[m+1].start : query.size();
+        string body = trim(query.substr(markers[m].bodyStart, end - markers[m].bodyStart));
+        switch (markers[m].clause) {
+            case kSelect:   result.what = body; break;
+            case kFrom:     result.from = body; break;
+            case kWhere:    result.where = body; break;
+            case kGroupBy:  result.groupBy = body; break;
+            case kHaving:   result.having = body; break;
+            case kLimit:    result.limit = body; break;
+            case kOffset:   result.offset = body; break;
+            case kOrderBy:
+                for (auto &item : splitList(body)) {
+                    OrderTerm term {item};
+                    if (removeSuffixWord(term.expression, "DESC"))
+                        term.descending = true;
+                    else
+                        removeSuffixWord(term.expression, "ASC");
+                    result.orderBy.push_back(term);
+                }
+                break;
+            case kNone:
+                break;
+        }
+    }
+    return result;
+}
+
+
+string N1QLClauses::toString() const {
+    string query = "SELECT " + what;
+    if (!from.empty())
+        query += " FROM " + from;
+    if (!where.empty())
+        query += " WHERE " + where;
+    if (!groupBy.empty())
+        query += " GROUP BY " + groupBy;
+    if (!having.empty())
+        query += " HAVING " + having;
+    for (size_t i = 0; i < orderBy.size(); ++i) {
+        query += (i == 0) ? " ORDER BY " : ", ";
+        query += orderBy[i].expression;
+        if (orderBy[i].descending)
+            query += " DESC";
+    }
+    if (!limit.empty())
+        query += " LIMIT " + limit;
+    if (!offset.empty())
+        query += " OFFSET " + offset;
+    return query;
+}
+
+
+void N1QLClauses::addWhere(const string &condition) {
+    if (where.empty())
+        where = condition;
+    else
+        where = "(" + where + ") AND " + condition;
+}
+
+
+vector<string> N1QLClauses::resultExpressions() const {
+    vector<string> expressions;
+    for (auto &item : resultItems())
+        expressions.push_back(item.first);
+    return expressions;
+}
+
+
+vector<pair<string,string>> N1QLClauses::resultItems() const {
+    string items = what;
+    if (upper(items.substr(0, 9)) == "DISTINCT " || upper(items.substr(0, 4)) == "ALL ")
+        items = trim(items.substr(items.find(' ')));
+    vector<pair<string,string>> result;
+    for (auto &expr : splitList(items)) {
+        // Split off a trailing `AS alias`:
+        size_t asPos = string::npos;
+        forEachTopLevelChar(expr, [&](size_t i) {
+            if ((expr[i] == 'A' || expr[i] == 'a') && i > 0 && isspace((unsigned char)expr[i-1])
+                    && i + 2 < expr.size() && toupper(expr[i+1]) == 'S'
+                    && isspace((unsigned char)expr[i+2]))
+                asPos = i;
+        });
+        if (asPos != string::npos)
+            result.emplace_back(trim(expr.substr(0, asPos)), unquote(trim(expr.substr(asPos + 2))));
+        else
+            result.emplace_back(expr, "");
+    }
+    return result;
+}
+
+
+void N1QLClauses::resolveOrderAliases() {
+    auto items = resultItems();
+    for (auto &term : orderBy) {
+        string name = unquote(term.expression);
+        for (auto &[expr, alias] : items) {
+            if (!alias.empty() && alias == name) {
+                term.expression = expr;
+                break;
+            }
+        }
+    }
+}
+
+
+bool N1QLClauses::addIDOrder() {
+    static const regex kJoin(R"(\b(JOIN|UNNEST)\b)", regex::icase);
+    if (!groupBy.empty() || regex_search(from, kJoin))
+        return false;
+    if (!orderBy.empty()) {
+        // Is the last term already `META().id` or `META(alias).id`?
+        string last;
+        for (char c : orderBy.back().expression) {
+            if (!isspace((unsigned char)c) && c != '`')
+                last += char(toupper((unsigned char)c));
+        }
+        string alias = from.empty() ? "" : upper(parseSource(from).alias);
+        if (last == "META().ID" || (!alias.empty() && last == "META(" + alias + ").ID"))
+            return true;
+    }
+    orderBy.push_back({"META().id"});
+    return true;
+}
+
+
+vector<string> N1QLClauses::splitList(const string &list) {
+    vector<string> items;
+    size_t start = 0;
+    forEachTopLevelChar(list, [&](size_t i) {
+        if (list[i] == ',') {
+            items.push_back(trim(list.substr(start, i - start)));
+            start = i + 1;
+        }
+    });
+    items.push_back(trim(list.substr(start)));
+    return items;
+}
+
+
+N1QLClauses::Source N1QLClauses::parseSource(const string &from) {
+    static const regex kSource(R"(^`?([\w.-]+?)`?(?:\s+(?:AS\s+)?`?(\w+)`?)?(?:\s|$))",
+                               regex::icase);
+    smatch m;
+    if (!regex_search(from, m, kSource))
+        return {};
+    string name = m[1], alias = m[2];
+    static const set<string> kKeywords {"JOIN", "INNER", "LEFT", "CROSS", "OUTER", "UNNEST",
+                                        "WHERE", "GROUP", "ORDER", "LIMIT"};
+    if (kKeywords.count(upper(alias)))
+        alias.clear();
+    Source source {"_default", name, alias};
+    if (auto dot = name.find('.'); dot != string::npos) {
+        source.scope = name.substr(0, dot);
+        source.collection = name.substr(dot + 1);
+    } else if (name == "_") {
+        source.collection = "_default";
+    }
+    if (source.alias.empty())
+        source.alias = (name.find('.') != string::npos) ? source.collection : name;
+    return source;
+}
+
+
+vector<string> N1QLClauses::splitConjunction(const string &condition) {
+    vector<string> terms;
+    size_t start = 0;
+    bool inBetween = false;
+    forEachTopLevelChar(condition, [&](size_t i) {
+        if (!isalpha((unsigned char)condition[i]) || (i > 0 && isIdentifierChar(condition[i-1])))
+            return;
+        size_t end = i;
+        while (end < condition.size() && isIdentifierChar(condition[end]))
+            ++end;
+        string word = upper(condition.substr(i, end - i));
+        if (word == "BETWEEN") {
+            inBetween = true;
+        } else if (word == "AND") {
+            if (inBetween) {
+                inBetween = false;
+            } else {
+                terms.push_back(trim(condition.substr(start, i - start)));
+                start = end;
+            }
+        }
+    });
+    terms.push_back(trim(condition.substr(start)));
+    // Remove redundant parentheses around a whole term:
+    for (auto &term : terms) {
+        while (term.size() >= 2 && term.front() == '(' && term.back() == ')') {
+            bool wraps = true;
+            forEachTopLevelChar(term, [&](size_t) {wraps = false;});
+            if (!wraps)
+                break;
+            term = trim(term.substr(1, term.size() - 2));
+        }
+    }
+    return terms;
+}
+
+
+bool N1QLClauses::isDistinct() const {
+    return upper(what.substr(0, 9)) == "DISTINCT ";
+}
+
+
+string N1QLClauses::afterCondition(const string &paramPrefix, const vector<bool> &unvalued) const {
+    // For terms (a, b, c): a > $0 OR (a = $0 AND b > $1) OR (a = $0 AND b = $1 AND c > $2)
+    auto isUnvalued = [&](size_t i) {return i < unvalued.size() && unvalued[i];};
+    auto equal = [&](size_t i) {
+        string expr = "(" + orderBy[i].expression + ")";
+        if (isUnvalued(i))
+            return expr + " IS NOT VALUED";
+        return expr + " = $" + paramPrefix + to_string(i);
+    };
+    auto after = [&](size_t i) {
+        // Unvalued (NULL/MISSING) sorts first, so it's after every value in descending order:
+        string expr = "(" + orderBy[i].expression + ")";
+        if (isUnvalued(i))
+            return orderBy[i].descending ? string("FALSE") : expr + " IS VALUED";
+        else if (orderBy[i].descending)
+            return "(" + expr + " < $" + paramPrefix + to_string(i) + " OR " + expr + " IS NOT VALUED)";
+        else
+            return expr + " > $" + paramPrefix + to_string(i);
+    };
+
+    string condition;
+    for (size_t i = 0; i < orderBy.size(); ++i) {
+        if (i > 0)
+            condition += " OR ";
+        condition += "(";
+        for (size_t j = 0; j < i; ++j)
+            condition += equal(j) + " AND ";
+        condition += after(i) + ")";
+    }
+    return "(" + condition + ")";
+}
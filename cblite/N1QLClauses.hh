@@ -0,0 +1,99 @@
+//
+// N1QLClauses.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/** A N1QL SELECT statement split into its top-level clauses, so that clauses can be examined or
+    changed without a real parser. Keywords inside parentheses, string literals or backquoted
+    identifiers are ignored, as are those that are part of a property path like `x.order`. */
+struct N1QLClauses {
+    struct OrderTerm {
+        std::string expression;
+        bool        descending = false;
+    };
+
+    std::string             what;               // Everything between SELECT and FROM
+    std::string             from;               // Including any JOINs
+    std::string             where;
+    std::string             groupBy;
+    std::string             having;
+    std::vector<OrderTerm>  orderBy;
+    std::string             limit;
+    std::string             offset;
+
+    /// A collection named in a FROM clause or JOIN.
+    struct Source {
+        std::string scope, collection, alias;
+    };
+
+    /// Splits a query into clauses. Returns nullopt if it doesn't start with SELECT, or if
+    /// a clause appears twice or out of order.
+    static std::optional<N1QLClauses> parse(const std::string &query);
+
+    /// Reassembles the query.
+    std::string toString() const;
+
+    /// ANDs a condition onto the WHERE clause.
+    void addWhere(const std::string &condition);
+
+    /// The expressions of the result columns, in order, without their `AS` aliases or any
+    /// DISTINCT.
+    std::vector<std::string> resultExpressions() const;
+
+    /// The result columns, in order, as pairs of expression and `AS` alias (empty if none).
+    std::vector<std::pair<std::string,std::string>> resultItems() const;
+
+    /// Replaces ORDER BY terms that are aliases of result columns, like `n` in
+    /// `SELECT count(*) AS n ... ORDER BY n`, with the columns' expressions, so that they can
+    /// be used elsewhere in the query, e.g. as another result column.
+    void resolveOrderAliases();
+
+    /// Appends `META().id` to the ORDER BY terms unless they already end with the doc ID, so
+    /// that no two rows sort the same, as keyset pagination needs. Returns false, changing
+    /// nothing, if the rows don't each have a doc ID because the query groups or joins them.
+    bool addIDOrder();
+
+    /// Parses a FROM source like "users", "inventory.hotels AS h" or "_ u" into its scope,
+    /// collection and alias. Anything after it, such as JOINs, is ignored. Returns an empty
+    /// collection name if it's not a collection, e.g. a subquery.
+    static Source parseSource(const std::string &from);
+
+    /// Splits a comma-separated list, like a GROUP BY clause, into its items.
+    static std::vector<std::string> splitList(const std::string &list);
+
+    /// Splits a condition into the terms that are ANDed together at its top level. (The AND in
+    /// `x BETWEEN a AND b` isn't a separator.)
+    static std::vector<std::string> splitConjunction(const std::string &condition);
+
+    /// True if the result columns start with DISTINCT.
+    bool isDistinct() const;
+
+    /// Returns a condition matching the rows that sort after a row whose ORDER BY terms have the
+    /// values of the query parameters `$<prefix>0`, `$<prefix>1`, ... This is the basis of keyset
+    /// ("seek") pagination: unlike OFFSET, it lets an index skip directly to the next page.
+    /// NULL and MISSING sort before all other values, and comparisons with them are never true,
+    /// so `unvalued[i]` must be true if the i'th value is NULL or MISSING; that term is then
+    /// tested with `IS [NOT] VALUED`. (NULL and MISSING are treated as equal to each other.)
+    std::string afterCondition(const std::string &paramPrefix,
+                               const std::vector<bool> &unvalued = {}) const;
+};
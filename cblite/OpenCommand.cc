@@ -17,6 +17,7 @@
 //
 
 #include "CBLiteCommand.hh"
+#include "QueryCache.hh"
 
 using namespace fleece;
 using namespace std;
@@ -41,6 +42,8 @@ public:
 
     virtual bool interactive() const override       {return _interactive;}
 
+    QueryCache* queryCache() override               {return _interactive ? &_queryCache : nullptr;}
+
 
     void runSubcommand() override {
         openDatabaseFromNextArg();
@@ -93,6 +96,9 @@ public:
         }
 
         cout << bold("Subcommands:") << "\n" <<
+        "    advise-indexes " << it("[FLAGS] QUERYFILE") << "\n"
+        "    backup " << it("[FLAGS] DESTINATION") << "\n"
+        "    bench " << it("[FLAGS] QUERY") << "\n"
         "    cat " << it("[FLAGS] DOCID [DOCID...]") << "\n"
         "    cd " << it("COLLECTION") << "\n"
         "    check\n"
@@ -121,6 +127,8 @@ public:
         "    query " << it("[FLAGS] JSON_QUERY") << "\n"
         "    quit\n"
         "    reindex\n"
+        "    replstatus " << it("[FLAGS]") << "\n"
+        "    restore " << it("DELTA [DELTA...]") << "\n"
         "    revs " << it("DOCID") << "\n"
         "    rm " << it("DOCID") << "\n"
         "    rmindex " << it("INDEX_NAME") << "\n"
@@ -135,6 +143,7 @@ public:
 
 private:
     bool _interactive = false;
+    QueryCache _queryCache;
 };
 
 
@@ -0,0 +1,211 @@
+//
+// OutputSink.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "OutputSink.hh"
+#include "LiteCoreTool.hh"
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef _MSC_VER
+    #include <io.h>
+    #define isatty _isatty
+    #define fileno _fileno
+#else
+    #include <unistd.h>
+#endif
+
+using namespace std;
+using namespace fleece;
+
+
+// Passes everything written to an `ostream` through to an OutputSink.
+class OutputSink::StreamBuf : public streambuf {
+public:
+    explicit StreamBuf(OutputSink &sink)    :_sink(sink) { }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof())
+            _sink.write(char(c));
+        return traits_type::not_eof(c);
+    }
+
+    streamsize xsputn(const char *s, streamsize n) override {
+        _sink.write(slice(s, size_t(n)));
+        return n;
+    }
+
+private:
+    OutputSink& _sink;
+};
+
+
+OutputSink& OutputSink::console() {
+    static OutputSink sConsole;
+    return sConsole;
+}
+
+
+OutputSink::OutputSink()
+:_file(stdout)
+,_terminal(isatty(fileno(stdout)))
+{
+    _buffer.reserve(kBufferSize);
+    // Use the same styles as the tool itself, which knows whether the terminal supports color:
+    if (auto tool = Tool::instance; _terminal && tool && !tool->ansiReset().empty()) {
+        _bold = tool->ansiBold();
+        _dim = tool->ansiDim();
+        _italic = tool->ansiItalic();
+        _noItalic = tool->ansiNoItalic();
+        _underline = tool->ansiUnderline();
+        _red = tool->ansiRed();
+        _reset = tool->ansiReset();
+    }
+    cout.flush();           // Don't let earlier output through `cout` come out after ours
+}
+
+
+OutputSink::OutputSink(const string &path)
+:_file(fopen(path.c_str(), "wb"))
+,_path(path)
+{
+    if (!_file)
+        LiteCoreTool::instance()->fail("Couldn't create " + path + ": " + strerror(errno));
+    _buffer.reserve(kBufferSize);
+}
+
+
+OutputSink::OutputSink(string *result)
+:_result(result)
+{ }
+
+
+OutputSink::~OutputSink() {
+    try {
+        flush();
+    } catch (...) { }
+    if (!_path.empty())
+        fclose(_file);
+}
+
+
+string OutputSink::ansi(const char *command) const {
+    if (_reset.empty())
+        return "";
+    return string("\033[") + command + "m";
+}
+
+
+void OutputSink::writePadded(slice s, size_t width, bool alignRight) {
+    size_t padSize = width - min(width, s.size);
+    if (alignRight)
+        pad(padSize);
+    write(s);
+    if (!alignRight)
+        pad(padSize);
+}
+
+
+void OutputSink::writeNumber(const char *buf, size_t size, size_t width) {
+    if (width > size)
+        pad(width - size);
+    write(slice(buf, size));
+}
+
+
+void OutputSink::writeInt(int64_t i, size_t width) {
+    char buf[24];
+    auto result = to_chars(buf, buf + sizeof(buf), i);
+    writeNumber(buf, result.ptr - buf, width);
+}
+
+
+void OutputSink::writeUInt(uint64_t i, size_t width) {
+    char buf[24];
+    auto result = to_chars(buf, buf + sizeof(buf), i);
+    writeNumber(buf, result.ptr - buf, width);
+}
+
+
+// Floating-point `to_chars` is missing from some standard libraries (older libc++ and
+// libstdc++), which don't define `__cpp_lib_to_chars`; those get `snprintf` instead, with the
+// fewest digits that read back as the same number, so the output is the same as `to_chars`'s.
+
+void OutputSink::writeDouble(double d, size_t width) {
+    char buf[32];
+#ifdef __cpp_lib_to_chars
+    auto result = to_chars(buf, buf + sizeof(buf), d);
+    writeNumber(buf, result.ptr - buf, width);
+#else
+    int size = 0;
+    for (int precision = 15; precision <= 17; ++precision) {
+        size = snprintf(buf, sizeof(buf), "%.*g", precision, d);
+        if (strtod(buf, nullptr) == d)
+            break;
+    }
+    writeNumber(buf, size_t(size), width);
+#endif
+}
+
+
+void OutputSink::writeDouble(double d, size_t width, int precision) {
+    char buf[32];
+#ifdef __cpp_lib_to_chars
+    auto result = to_chars(buf, buf + sizeof(buf), d, chars_format::general, precision);
+    writeNumber(buf, result.ptr - buf, width);
+#else
+    int size = snprintf(buf, sizeof(buf), "%.*g", precision, d);
+    writeNumber(buf, min(size_t(size), sizeof(buf) - 1), width);
+#endif
+}
+
+
+ostream& OutputSink::stream() {
+    if (!_stream) {
+        _streamBuf = make_unique<StreamBuf>(*this);
+        _stream = make_unique<ostream>(_streamBuf.get());
+    }
+    return *_stream;
+}
+
+
+void OutputSink::flushBuffer() {
+    if (_buffer.empty())
+        return;
+    if (_result) {
+        _result->append(_buffer);
+        _buffer.clear();
+        return;
+    }
+    size_t written = fwrite(_buffer.data(), 1, _buffer.size(), _file);
+    bool ok = (written == _buffer.size());
+    _buffer.clear();
+    if (!ok)
+        LiteCoreTool::instance()->fail(string("Couldn't write output: ") + strerror(errno));
+}
+
+
+void OutputSink::flush() {
+    flushBuffer();
+    if (_file)
+        fflush(_file);
+}
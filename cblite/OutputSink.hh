@@ -0,0 +1,135 @@
+//
+// OutputSink.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "fleece/slice.hh"
+#include <concepts>
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+
+/** A fast, buffered output stream for bulk output, such as query results and document listings.
+    Text is appended to a large buffer that's written out in big chunks, bypassing iostreams.
+
+    `console()` is the sink for stdout shared by all commands. Its ANSI style strings are empty
+    unless stdout is a color terminal, so output piped to a file or another program is plain text.
+    Anything written to `cout` or `cerr` after using it must be preceded by a `flush()`, or it
+    may come out first. */
+class OutputSink {
+public:
+    /// The shared sink that writes to stdout.
+    static OutputSink& console();
+
+    /// Writes to a new file at `path`, replacing any existing file. Fails if it can't be created.
+    explicit OutputSink(const std::string &path);
+
+    /// Appends to a string; the string is complete after `flush`.
+    explicit OutputSink(std::string *result);
+
+    ~OutputSink();
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    /// True if writing to a terminal.
+    bool isTerminal() const                             {return _terminal;}
+
+    // ANSI escape sequences for styling text; empty unless writing to a color terminal.
+    const std::string& bold() const                     {return _bold;}
+    const std::string& dim() const                      {return _dim;}
+    const std::string& italic() const                   {return _italic;}
+    const std::string& noItalic() const                 {return _noItalic;}
+    const std::string& underline() const                {return _underline;}
+    const std::string& red() const                      {return _red;}
+    const std::string& reset() const                    {return _reset;}
+    std::string ansi(const char *command) const;
+
+    void write(fleece::slice s) {
+        if (_buffer.size() + s.size > kBufferSize)
+            flushBuffer();
+        _buffer.append((const char*)s.buf, s.size);
+    }
+
+    void write(char c) {
+        if (_buffer.size() >= kBufferSize)
+            flushBuffer();
+        _buffer.push_back(c);
+    }
+
+    /// Writes `n` spaces.
+    void pad(size_t n) {
+        if (_buffer.size() + n > kBufferSize)
+            flushBuffer();
+        _buffer.append(n, ' ');
+    }
+
+    /// Writes a string padded with spaces to at least `width` bytes.
+    void writePadded(fleece::slice s, size_t width, bool alignRight = false);
+
+    // Numbers are right-aligned in `width` columns, if it's nonzero:
+    void writeInt(int64_t, size_t width = 0);
+    void writeUInt(uint64_t, size_t width = 0);
+    void writeDouble(double, size_t width = 0);
+    /// Writes a double with `precision` significant digits, like `printf("%.*g")`.
+    void writeDouble(double, size_t width, int precision);
+
+    OutputSink& operator<< (fleece::slice s)            {write(s); return *this;}
+    OutputSink& operator<< (const fleece::alloc_slice &s) {write(s); return *this;}
+    OutputSink& operator<< (std::string_view s)         {write(fleece::slice(s)); return *this;}
+    OutputSink& operator<< (const std::string &s)       {write(fleece::slice(s)); return *this;}
+    OutputSink& operator<< (const char *s)              {write(fleece::slice(s)); return *this;}
+    OutputSink& operator<< (char c)                     {write(c); return *this;}
+    OutputSink& operator<< (double d)                   {writeDouble(d); return *this;}
+
+    template <std::integral INT>
+    OutputSink& operator<< (INT i) {
+        if constexpr (std::is_signed_v<INT>)
+            writeInt(i);
+        else
+            writeUInt(i);
+        return *this;
+    }
+
+    /// An `ostream` that writes to this sink, for APIs that only write to streams. It's
+    /// unbuffered, so its output and direct writes to the sink can be interleaved.
+    std::ostream& stream();
+
+    /// Writes the buffered output to the file or stdout, and flushes it.
+    void flush();
+
+private:
+    static constexpr size_t kBufferSize = 1 << 20;
+
+    class StreamBuf;
+
+    OutputSink();
+    void flushBuffer();
+    void writeNumber(const char *buf, size_t size, size_t width);
+
+    FILE*               _file = nullptr;
+    std::string         _path;          // Empty if stdout or a string
+    std::string*        _result = nullptr;
+    std::string         _buffer;
+    bool                _terminal = false;
+    std::string         _bold, _dim, _italic, _noItalic, _underline, _red, _reset;
+    std::unique_ptr<StreamBuf>      _streamBuf;
+    std::unique_ptr<std::ostream>   _stream;
+};
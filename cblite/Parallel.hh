@@ -0,0 +1,213 @@
+//
+// Parallel.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "c4Database.h"
+#include "c4Base.hh"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Small helpers for commands that spread work across threads. LiteCore database handles aren't
+// thread-safe, so each thread that reads a database should open its own connection to it with
+// `openReadOnlyConnection`, or borrow one from a `ConnectionPool`.
+
+
+/// A reasonable number of worker threads: the number of CPU cores, but at least 2 and at most 8.
+static inline unsigned defaultParallelism() {
+    return std::clamp(std::thread::hardware_concurrency(), 2u, 8u);
+}
+
+
+/// Calls `fn(i)` for every `i` in [0, n), on up to `nThreads` threads (including the calling
+/// one.) Items are handed out in order as threads become free. If any call throws, no new items
+/// are started, and the first exception is rethrown on the calling thread once all threads exit.
+static inline void parallelFor(size_t n, unsigned nThreads, const std::function<void(size_t)> &fn) {
+    std::atomic<size_t> next {0};
+    std::atomic<bool> stop {false};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto worker = [&] {
+        size_t i;
+        while (!stop && (i = next++) < n) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error)
+                    error = std::current_exception();
+                stop = true;
+            }
+        }
+    };
+
+    nThreads = unsigned(std::clamp(size_t(nThreads), size_t(1), std::max(n, size_t(1))));
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < nThreads; ++t)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads)
+        thread.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+
+/// Opens another, read-only, connection to the same database file as `db`, using its config
+/// (including any encryption key.) Returns nullptr on failure.
+static inline c4::ref<C4Database> openReadOnlyConnection(C4Database *db, C4Error *outError) {
+    C4DatabaseConfig2 config = *c4db_getConfig2(db);
+    config.flags = (config.flags | kC4DB_ReadOnly) & ~kC4DB_Create;
+    return c4db_openNamed(c4db_getName(db), &config, outError);
+}
+
+
+/// A set of connections (or anything else a thread needs exclusive use of) shared by the threads
+/// of a `parallelFor`: `acquire` lends one that no other thread is using, and the `Lease` gives it
+/// back when it's destroyed. There must be at least as many items as threads, and all of them
+/// must be added before the threads start.
+template <class T = c4::ref<C4Database>>
+class ConnectionPool {
+public:
+    class Lease {
+    public:
+        Lease(const Lease&) = delete;
+        ~Lease()                                    {_pool.release(_index);}
+        T& operator*() const                        {return _pool._items[_index];}
+        T* operator->() const                       {return &_pool._items[_index];}
+    private:
+        friend class ConnectionPool;
+        Lease(ConnectionPool &pool, size_t index)   :_pool(pool), _index(index) { }
+        ConnectionPool& _pool;
+        size_t const    _index;
+    };
+
+    size_t size() const                             {return _items.size();}
+
+    void add(T item) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _idle.push_back(_items.size());
+        _items.push_back(std::move(item));
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _items.clear();
+        _idle.clear();
+    }
+
+    Lease acquire() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        assert(!_idle.empty());
+        size_t index = _idle.back();
+        _idle.pop_back();
+        return Lease(*this, index);
+    }
+
+private:
+    void release(size_t index) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _idle.push_back(index);
+    }
+
+    std::vector<T>          _items;
+    std::vector<size_t>     _idle;          // Indexes of items not in use
+    std::mutex              _mutex;
+};
+
+
+/// Adds read-only connections to `db`, opened with `openReadOnlyConnection`, until `pool` has
+/// `n`. Returns false on failure.
+static inline bool addReadOnlyConnections(ConnectionPool<> &pool, C4Database *db, size_t n,
+                                          C4Error *outError)
+{
+    while (pool.size() < n) {
+        c4::ref<C4Database> conn = openReadOnlyConnection(db, outError);
+        if (!conn)
+            return false;
+        pool.add(std::move(conn));
+    }
+    return true;
+}
+
+
+/// A thread-safe FIFO queue with a maximum size, connecting producer threads to a consumer.
+/// `push` blocks while the queue is full; `pop` blocks while it's empty. Once `close` is
+/// called, `push` returns false and `pop` returns nullopt after the queue drains.
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity)      :_capacity(std::max(capacity, size_t(1))) { }
+
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notFull.wait(lock, [&]{return _closed || _items.size() < _capacity;});
+        if (_closed)
+            return false;
+        _items.push_back(std::move(item));
+        _notEmpty.notify_one();
+        return true;
+    }
+
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notEmpty.wait(lock, [&]{return _closed || !_items.empty();});
+        if (_items.empty())
+            return std::nullopt;
+        T item = std::move(_items.front());
+        _items.pop_front();
+        _notFull.notify_one();
+        return item;
+    }
+
+    /// Like `pop`, but gives up after `timeout`, returning nullopt with `*timedOut` set.
+    template <class Duration>
+    std::optional<T> popFor(Duration timeout, bool *timedOut) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        *timedOut = !_notEmpty.wait_for(lock, timeout, [&]{return _closed || !_items.empty();});
+        if (_items.empty())
+            return std::nullopt;
+        T item = std::move(_items.front());
+        _items.pop_front();
+        _notFull.notify_one();
+        return item;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        _notFull.notify_all();
+        _notEmpty.notify_all();
+    }
+
+private:
+    size_t const            _capacity;
+    std::deque<T>           _items;
+    bool                    _closed {false};
+    std::mutex              _mutex;
+    std::condition_variable _notFull, _notEmpty;
+};
@@ -0,0 +1,90 @@
+//
+// QueryCache.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "QueryCache.hh"
+#include "LiteCoreTool.hh"
+#include "Parallel.hh"
+#include <cctype>
+
+using namespace std;
+
+
+C4Query* QueryCache::get(C4QueryLanguage lang, const string &queryStr) {
+    auto i = _map.find(keyFor(lang, queryStr));
+    if (i == _map.end())
+        return nullptr;
+    _lru.splice(_lru.begin(), _lru, i->second);     // Move it to the front
+    return i->second->second;
+}
+
+
+C4Query* QueryCache::add(C4QueryLanguage lang, const string &queryStr, c4::ref<C4Query> query) {
+    string key = keyFor(lang, queryStr);
+    if (auto i = _map.find(key); i != _map.end()) {
+        _lru.erase(i->second);
+        _map.erase(i);
+    }
+    _lru.emplace_front(key, std::move(query));
+    _map[key] = _lru.begin();
+    if (_lru.size() > _capacity) {
+        _map.erase(_lru.back().first);
+        _lru.pop_back();
+    }
+    return _lru.front().second;
+}
+
+
+C4Database* QueryCache::connection(C4Database *db) {
+    if (!_connection) {
+        C4Error error;
+        _connection = openReadOnlyConnection(db, &error);
+        if (!_connection)
+            LiteCoreTool::instance()->fail("opening a query connection to the database", error);
+    }
+    return _connection;
+}
+
+
+string QueryCache::normalize(const string &queryStr) {
+    string result;
+    result.reserve(queryStr.size());
+    char quote = 0;
+    bool escaped = false, pendingSpace = false;
+    for (char c : queryStr) {
+        if (quote) {
+            result += c;
+            if (escaped)
+                escaped = false;
+            else if (c == '\\')
+                escaped = true;
+            else if (c == quote)
+                quote = 0;          // (A doubled quote just reopens the literal)
+        } else if (isspace((unsigned char)c)) {
+            pendingSpace = !result.empty();
+        } else {
+            if (pendingSpace) {
+                result += ' ';
+                pendingSpace = false;
+            }
+            result += c;
+            if (c == '\'' || c == '"' || c == '`')
+                quote = c;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,76 @@
+//
+// QueryCache.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "c4.hh"
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+
+/** A least-recently-used cache of compiled queries, used in interactive mode so that running
+    the same query again doesn't recompile it. Queries are keyed by language and by their text
+    with insignificant whitespace removed.
+
+    A compiled query depends on the database's indexes, so the cache must be cleared whenever
+    they change.
+
+    Queries are compiled on a separate read-only connection to the database, so they can run on
+    a background thread (see InterruptibleQuery.) While one is running, `busy` is set, and
+    neither the connection nor the cached queries may be used on another thread. */
+class QueryCache {
+public:
+    explicit QueryCache(size_t capacity = 32)
+    :_capacity(capacity)
+    { }
+
+    /// Returns the cached query, or null.
+    C4Query* get(C4QueryLanguage, const std::string &queryStr);
+
+    /// Adds a query to the cache, evicting the least recently used one if it's full.
+    /// Returns the query, which now belongs to the cache.
+    C4Query* add(C4QueryLanguage, const std::string &queryStr, c4::ref<C4Query> query);
+
+    void clear()                                {_map.clear(); _lru.clear();}
+
+    /// The connection to compile queries on: a read-only connection to the same file as `db`,
+    /// opened the first time this is called.
+    C4Database* connection(C4Database *db);
+
+    /// Set while a query compiled on the connection is running on a background thread.
+    const std::shared_ptr<std::atomic<bool>>& busy() const  {return _busy;}
+
+    /// Collapses runs of whitespace outside string literals and quoted identifiers to a single
+    /// space, and trims whitespace from the ends.
+    static std::string normalize(const std::string &queryStr);
+
+private:
+    using Entry = std::pair<std::string, c4::ref<C4Query>>;
+
+    static std::string keyFor(C4QueryLanguage lang, const std::string &queryStr) {
+        return char('0' + lang) + normalize(queryStr);
+    }
+
+    size_t const                                                    _capacity;
+    c4::ref<C4Database>                                             _connection;
+    std::shared_ptr<std::atomic<bool>>                              _busy = std::make_shared<std::atomic<bool>>(false);
+    std::list<Entry>                                                _lru;       // Newest first
+    std::unordered_map<std::string, std::list<Entry>::iterator>     _map;
+};
@@ -17,8 +17,33 @@
 //
 
 #include "CBLiteCommand.hh"
+#include "BatchQuery.hh"
+#include "FederatedQuery.hh"
+#include "InterruptibleQuery.hh"
+#include "N1QLClauses.hh"
+#include "OutputSink.hh"
+#include "QueryCache.hh"
+#include "QueryMaterializer.hh"
+#include "QueryPlan.hh"
+#include "QueryRows.hh"
+#include "TableWriter.hh"
 #include "fleece/FLExpert.h"
 #include "StringUtil.hh"
+#include "Stopwatch.hh"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <regex>
+
+#ifndef _MSC_VER
+#include <glob.h>
+#endif
 
 using namespace std;
 using namespace litecore;
@@ -44,9 +69,26 @@ public:
             "  Runs a query against the database, in JSON or N1QL format.\n"
             "    --raw :      Output JSON (instead of a table)\n"
             "    --json5 :    Omit quotes around alphanmeric keys in JSON output\n"
+            "    --format F : Output format: table, json, ndjson, csv or tsv\n"
+            "    --out FILE : Write the results to FILE\n"
             "    --offset N : Skip first N rows\n"
             "    --limit N :  Stop after N rows\n"
+            "    --after JSON : Page with --limit, starting after the row whose ORDER BY\n"
+            "                   values are in this JSON array ([] for the first page)\n"
+            "                   (N1QL only)\n"
             "    --explain :  Show SQLite query and explain query plan\n"
+            "    --analyze :  Run the query and report its timing, row count, and plan\n"
+            "    --watch :    Keep running, and show the results again whenever they change\n"
+            "    --timeout SECS : Stop the query after SECS seconds, showing the rows found so far\n"
+            "    --dbs GLOB : Query every database matching GLOB, instead of DBPATH; adds a '_db' column\n"
+            "                 (N1QL only)\n"
+            "    --params-file FILE : Run the query with each line of FILE, a JSON object, as its\n"
+            "                 parameters; adds a '_line' column\n"
+            "    --jobs N :   With --dbs or --params-file, run at most N queries at once\n"
+            "    --into COLL : Store the results as documents of collection COLL (N1QL only)\n"
+            "    --id COLUMN : With --into, the column the docIDs come from [default: the first]\n"
+            "    --refresh :  With --into, only recompute the results affected by changes since\n"
+            "                 the last run\n"
             "  " << it("QUERYSTRING") << " : LiteCore JSON or N1QL query expression\n";
         } else {
             writeUsageCommand("select", true, "N1QLSTRING");
@@ -54,7 +96,24 @@ public:
             "  Runs a N1QL query against the database.\n"
             "    --raw :      Output JSON (instead of a table)\n"
             "    --json5 :    Omit quotes around alphanmeric keys in JSON output\n"
+            "    --format F : Output format: table, json, ndjson, csv or tsv\n"
+            "    --out FILE : Write the results to FILE\n"
+            "    --offset N : Skip first N rows\n"
+            "    --limit N :  Stop after N rows\n"
+            "    --after JSON : Page with --limit, starting after the row whose ORDER BY\n"
+            "                   values are in this JSON array ([] for the first page)\n"
             "    --explain :  Show translated SQLite query and explain query plan\n"
+            "    --analyze :  Run the query and report its timing, row count, and plan\n"
+            "    --watch :    Keep running, and show the results again whenever they change\n"
+            "    --timeout SECS : Stop the query after SECS seconds, showing the rows found so far\n"
+            "    --dbs GLOB : Query every database matching GLOB, instead of DBPATH; adds a '_db' column\n"
+            "    --params-file FILE : Run the query with each line of FILE, a JSON object, as its\n"
+            "                 parameters; adds a '_line' column\n"
+            "    --jobs N :   With --dbs or --params-file, run at most N queries at once\n"
+            "    --into COLL : Store the results as documents of collection COLL (N1QL only)\n"
+            "    --id COLUMN : With --into, the column the docIDs come from [default: the first]\n"
+            "    --refresh :  With --into, only recompute the results affected by changes since\n"
+            "                 the last run\n"
             "  " << it("N1QLSTRING") << " : N1QL query, minus the 'SELECT'\n";        }
         if (interactive())
             cerr << "    NOTE: Do not quote the query string, just give it literally.\n";
@@ -65,12 +124,32 @@ public:
         // Read params:
         processFlags({
             {"--explain",[&]{_explain = true;}},
+            {"--analyze",[&]{_analyze = true;}},
+            {"--watch",  [&]{_watch = true;}},
+            {"--timeout",[&]{_timeout = parseNextArg<unsigned>("timeout in seconds", 1);}},
             {"--limit",  [&]{limitFlag();}},
             {"--offset", [&]{offsetFlag();}},
             {"--raw",    [&]{rawFlag();}},
             {"--json5",  [&]{json5Flag();}},
+            {"--format", [&]{formatFlag();}},
+            {"--out",    [&]{_outPath = nextArg("output file");}},
+            {"--after",  [&]{_after = nextArg("ORDER BY values");}},
+            {"--dbs",    [&]{_dbsPattern = nextArg("database path pattern");}},
+            {"--jobs",   [&]{_jobs = parseNextArg<unsigned>("number of jobs", 1);}},
+            {"--params-file", [&]{_paramsFile = nextArg("parameters file");}},
+            {"--into",   [&]{_into = nextArg("collection name");}},
+            {"--id",     [&]{_idColumn = nextArg("ID column name");}},
+            {"--refresh",[&]{_refresh = true;}},
         });
-        openDatabaseFromNextArg();
+        if (_into.empty() && (_refresh || !_idColumn.empty()))
+            failMisuse("--id and --refresh require --into");
+        vector<string> dbPaths;
+        if (!_into.empty())
+            openWriteableDatabaseFromNextArg();
+        else if (_dbsPattern.empty())
+            openDatabaseFromNextArg();
+        else
+            dbPaths = matchingDatabases(_dbsPattern);
         string queryStr = restOfInput("query string");
 
         // Possibly translate query from N1QL to JSON:
@@ -82,23 +161,67 @@ public:
             queryStartPos += 6;  // length of "query "
         }
 
-        // Compile query:
+        if (!dbPaths.empty() && _language != kC4N1QLQuery)
+            failMisuse("--dbs requires a N1QL query");
+        if (!dbPaths.empty() && _watch)
+            failMisuse("--watch can't be used with --dbs");
+        if (!_into.empty())
+            return materializeQuery(queryStr);
+        if (!_paramsFile.empty() && (!dbPaths.empty() || _watch || _analyze || _timeout
+                                     || !_after.empty() || !_into.empty()))
+            failMisuse("--params-file can't be used with --dbs, --watch, --analyze, --timeout, "
+                       "--after or --into");
+
+        // The ORDER BY values are added as hidden columns only when paging with `--after`, so
+        // the next page's cursor can be printed, or to merge the results of a federated query:
+        alloc_slice afterParams;
+        if (!_after.empty() || !dbPaths.empty())
+            afterParams = addKeysetPaging(queryStr, !dbPaths.empty());
+        if (!dbPaths.empty())
+            return runFederated(dbPaths, queryStr, queryStartPos, afterParams);
+
+        // In interactive mode, or with a timeout, the query runs on a background thread so that
+        // it can be interrupted. That needs a database connection of its own. With a timeout, it
+        // runs in pages if it can, so that there are partial results to show if it times out.
+        bool background = (_timeout || interactive()) && !_explain && !_analyze && !_watch
+                        && _paramsFile.empty();
+        if (background && _timeout)
+            _pageInBackground = canPage(queryStr);
+
+        // Compile query, or reuse it if it's been compiled before in this session. Cached queries
+        // belong to the cache's connection, which can't be used while an interrupted query is
+        // still running on it.
         C4Error error;
         size_t errorPos;
-        c4::ref<C4Query> query = compileQuery(_language, queryStr, &errorPos, &error);
+        QueryCache *cache = queryCache();
+        if (cache && *cache->busy())
+            cache = nullptr;
+        C4Database *connection = _db;
+        c4::ref<C4Database> ownConnection;
+        if (cache) {
+            connection = cache->connection(_db);
+        } else if (background) {
+            ownConnection = openReadOnlyConnection(_db, &error);
+            if (!ownConnection)
+                fail("opening a query connection to the database", error);
+            connection = ownConnection;
+        }
+
+        c4::ref<C4Query> compiled;
+        C4Query *query = nullptr;
+        string cacheKey = queryStr;
+        if (usesPagingParams())
+            cacheKey += " LIMIT $limit OFFSET $offset";
+        if (cache)
+            query = cache->get(_language, cacheKey);
+        optional<double> compileTime;
         if (!query) {
-            if (error.domain == LiteCoreDomain && error.code == kC4ErrorInvalidQuery) {
-                if (interactive()) {
-                    errorPos += queryStartPos;
-                } else {
-                    cerr << queryStr << "\n";
-                }
-                cerr << string(errorPos, ' ') << "^\n";
-                alloc_slice errorMessage = c4error_getMessage(error);
-                fail(string(errorMessage));
-            } else {
-                fail("compiling query", error);
-            }
+            Stopwatch st;
+            compiled = compileQuery(_language, queryStr, &errorPos, &error, connection);
+            compileTime = st.elapsed();
+            if (!compiled)
+                failCompiling(queryStr, errorPos, queryStartPos, error);
+            query = cache ? cache->add(_language, cacheKey, std::move(compiled)) : compiled.get();
         }
 
         if (_explain) {
@@ -106,154 +229,773 @@ public:
             alloc_slice explanation = c4query_explain(query);
             cout << explanation;
 
+        } else if (_analyze) {
+            analyzeQuery(query, queryParameters(afterParams), compileTime);
+
+        } else if (_watch) {
+            watchQuery(query, queryParameters(afterParams));
+
+        } else if (!_paramsFile.empty()) {
+            runBatch(query, queryStr, queryStartPos);
+
+        } else if (background) {
+            // Run query on a background thread, until it's done, times out, or Ctrl-C is pressed:
+            InterruptHandler interruptHandler;
+            vector<string> titles = columnTitles(query);
+            InterruptibleQuery::Options options;
+            options.timeout = _timeout;
+            options.paged = _pageInBackground;
+            options.offset = _offset;
+            options.limit = _limit;
+            InterruptibleQuery rows(c4db_retain(connection), c4query_retain(query),
+                                    queryParameters(afterParams), options,
+                                    cache ? cache->busy() : nullptr);
+            uint64_t nRows = writeResults(titles, rows);
+            if (const char *why = rows.interruption())
+                cerr << "(Partial results: the query " << why << " after " << nRows << " rows)\n";
+            else if (_cursorColumns > 0 && _limit > 0 && nRows >= uint64_t(_limit))
+                printCursor(rows.columns());    // still on the last row
+
         } else {
             // Run query:
-            // Set parameters:
-            alloc_slice params;
-            if (_offset > 0 || _limit >= 0) {
-                JSONEncoder enc;
-                enc.beginDict();
-                enc.writeKey("offset"_sl);
-                enc.writeInt(_offset);
-                enc.writeKey("limit"_sl);
-                enc.writeInt(_limit);
-                enc.endDict();
-                params = enc.finish();
-            }
-            c4::ref<C4QueryEnumerator> e = c4query_run(query, params, &error);
+            c4::ref<C4QueryEnumerator> e = c4query_run(query, queryParameters(afterParams), &error);
             if (!e)
                 fail("starting query", error);
 
-            if (_prettyPrint)
-                displayQueryAsTable(query, e);
-            else
-                displayQueryAsJSON(query, e);
+            EnumeratorRows rows(e);
+            uint64_t nRows = writeResults(columnTitles(query), rows);
+            if (_cursorColumns > 0 && _limit > 0 && nRows >= uint64_t(_limit)) {
+                if (!c4queryenum_seek(e, int64_t(nRows - 1), &error))
+                    fail("reading query results", error);
+                printCursor(Array::iterator(e->columns));
+            }
         }
     }
 
 
-    void displayQueryAsJSON(C4Query *query, C4QueryEnumerator *e) {
-        unsigned nCols = c4query_columnCount(query);
-        vector<string> colTitle(nCols);
+    // Stores the results as documents of the `--into` collection, or with `--refresh`, updates
+    // the ones affected by changes since the last time.
+    void materializeQuery(const string &queryStr) {
+        if (_language != kC4N1QLQuery)
+            failMisuse("--into requires a N1QL query");
+        if (_explain || _analyze || _watch || _timeout || !_after.empty() || _offset > 0
+                || _limit >= 0 || _format || !_outPath.empty())
+            failMisuse("--into can't be used with output, paging, --explain, --analyze, --watch "
+                       "or --timeout options");
+        auto [scope, name] = getCollectionPath(_into);
+        QueryMaterializer materializer(_db, queryStr, _idColumn, {slice(name), slice(scope)});
+        if (_refresh && !materializer.notRefreshableReason().empty())
+            failMisuse("--refresh can't be used with this query, because "
+                       + materializer.notRefreshableReason());
 
-        for (unsigned col = 0; col < nCols; ++col) {
-            auto title = string(slice(c4query_columnTitle(query, col)));
-            if (!_json5 || !canBeUnquotedJSON5Key(title))
-                title = "\"" + title + "\"";
-            colTitle[col] = title;
-        }
+        Stopwatch st;
+        auto stats = materializer.run(_refresh);
+        if (stats.refreshed)
+            cout << "Refreshed " << _into << " after changes to " << stats.changedSources
+                 << " docs: recomputed " << stats.rows << " rows";
+        else
+            cout << "Stored " << stats.rows << " rows in " << _into;
+        cout << "; " << stats.written << " docs written, " << stats.deleted << " deleted, in "
+             << stringprintf("%.3f", st.elapsed()) << " secs\n";
+        if (stats.skipped > 0)
+            cerr << "(" << stats.skipped << " rows were skipped because their '"
+                 << materializer.idColumn() << "' column isn't a string or number)\n";
+    }
 
-        uint64_t nRows = 0;
+
+    // True if the query can be run in pages with LIMIT and OFFSET: its rows don't need to be
+    // sorted, grouped or aggregated first, so a page only costs as much as the rows up to its end.
+    bool canPage(const string &queryStr) {
+        if (_language != kC4N1QLQuery)
+            return false;
+        static const regex kAggregate(R"(\bDISTINCT\b|\b(COUNT|SUM|AVG|MIN|MAX|ARRAY_AGG)\s*\()",
+                                      regex::icase);
+        auto clauses = N1QLClauses::parse(queryStr);
+        return clauses && clauses->orderBy.empty() && clauses->groupBy.empty()
+                       && clauses->limit.empty() && clauses->offset.empty()
+                       && !regex_search(clauses->what, kAggregate);
+    }
+
+
+    // True if the query is compiled with `LIMIT $limit OFFSET $offset` appended.
+    bool usesPagingParams() const {
+        return _offset > 0 || _limit >= 0 || _pageInBackground;
+    }
+
+
+    // Runs the query without printing its results, then reports how long compiling it, getting
+    // the first row, and getting all the rows took, and its query plan with the costly steps
+    // pointed out. (LiteCore doesn't expose SQLite's per-step counters, so the number of rows a
+    // full scan visits is estimated from its collection's document count.)
+    void analyzeQuery(C4Query *query, slice params, optional<double> compileTime) {
         C4Error error;
-        cout << "[";
+        Stopwatch st;
+        c4::ref<C4QueryEnumerator> e = c4query_run(query, params, &error);
+        if (!e)
+            fail("starting query", error);
+        uint64_t nRows = 0;
+        double firstRowTime = 0;
         while (c4queryenum_next(e, &error)) {
-            // Write a result row:
-            if (nRows++)
-                cout << ",\n ";
-            cout << "{";
-            int col = 0, n = 0;
-            for (Array::iterator i(e->columns); i; ++i, ++col) {
-                if (!(e->missingColumns & (1<<col))) {
-                    if (n++)
-                        cout << ", ";
-                    cout << colTitle[col] << ": ";
-                    rawPrint(i.value(), nullslice);
-                }
-            }
-            cout << "}";
+            if (nRows++ == 0)
+                firstRowTime = st.elapsed();
         }
         if (error.code)
             fail("running query", error);
-        cout << "]\n";
+        double runTime = st.elapsed();
+
+        if (compileTime)
+            cout << "Compile time:   " << stringprintf("%.3f ms\n", *compileTime * 1000);
+        else
+            cout << "Compile time:   (cached)\n";
+        cout << "Execution time: " << stringprintf("%.3f ms", runTime * 1000);
+        if (nRows > 0)
+            cout << stringprintf("  (first row after %.3f ms)", firstRowTime * 1000);
+        cout << "\nRows returned:  " << nRows << "\n\n";
+
+        QueryPlan plan = QueryPlan::parse(alloc_slice(c4query_explain(query)));
+        cout << "Query plan:\n";
+        for (auto &step : plan.steps) {
+            string line = string(2 * step.depth + 4, ' ') + step.detail;
+            string note;
+            if (step.fullScan) {
+                note = "FULL SCAN";
+                string scope, name;
+                if (auto spec = QueryPlan::collectionForTable(step.table, scope, name)) {
+                    if (C4Collection *coll = c4db_getCollection(_db, *spec, nullptr))
+                        note += stringprintf(" of ~%llu docs",
+                                             (unsigned long long)c4coll_getDocumentCount(coll));
+                }
+            } else if (step.tempBTree) {
+                note = "sorts or groups all matching rows";
+            }
+            cout << line;
+            if (!note.empty()) {
+                if (line.size() < 56)
+                    cout << string(56 - line.size(), ' ');
+                cout << "  " << ansiBold() << "<-- " << note << ansiReset();
+            }
+            cout << "\n";
+        }
+        if (plan.hasFullScan())
+            cout << "\nFull scans read every document; an index on the WHERE or ORDER BY "
+                    "expressions (see `mkindex`) may avoid them.\n";
     }
 
 
-    void displayQueryAsTable(C4Query *query, C4QueryEnumerator *e) {
-        unsigned nCols = c4query_columnCount(query);
-        uint64_t nRows;
-        vector<size_t> widths(nCols);
-        unsigned col;
+    // Displays the results, then keeps displaying them again whenever they change, until
+    // Ctrl-C is pressed. A query observer reports changes committed by this process; changes made by
+    // other processes are noticed by checking the database files' modification time, and then
+    // re-running the query, but the results are only shown if they're different. Each update
+    // shows how long after the commit (the files' modification time) it appeared.
+    void watchQuery(C4Query *query, slice params) {
         C4Error error;
+        c4::ref<C4QueryEnumerator> e = c4query_run(query, params, &error);
+        if (!e)
+            fail("starting query", error);
+        vector<string> titles = columnTitles(query);
+        auto display = [&](C4QueryEnumerator *results, const char *cause) {
+            if (cause) {
+                auto latency = chrono::duration_cast<chrono::milliseconds>(
+                                            filesystem::file_time_type::clock::now() - dbModTime());
+                cout << "\n" << ansiBold() << "Results changed (" << cause << ", "
+                     << latency.count() << " ms after commit):" << ansiReset() << "\n";
+            }
+            EnumeratorRows rows(results);
+            writeResults(titles, rows);
+            cout.flush();
+        };
+        display(e, nullptr);
 
-        // Compute the column widths:
-        for (col = 0; col < nCols; ++col) {
-            auto title = c4query_columnTitle(query, col);
-            widths[col] = title.size;  // not UTF-8-aware...
-        }
-        nRows = 0;
-        while (c4queryenum_next(e, &error)) {
-            ++nRows;
-            col = 0;
-            for (Array::iterator i(e->columns); i; ++i) {
-                if (!(e->missingColumns & (1<<col))) {
-                    size_t width;
-                    if (i.value().type() == kFLString)
-                        width = i.value().asString().size;
-                    else
-                        width = i.value().toJSON(_json5, true).size;
-                    widths[col] = max(widths[col], width);
+        struct Notification {
+            mutex               mutex;
+            condition_variable  cond;
+            bool                changed = false;
+        } notification;
+        c4query_setParameters(query, params);   // the observer runs the query with these
+        c4::ref<C4QueryObserver> observer = c4queryobs_create(query,
+                                                              [](C4QueryObserver*, C4Query*, void *ctx) {
+            auto n = (Notification*)ctx;
+            lock_guard<mutex> lock(n->mutex);
+            n->changed = true;
+            n->cond.notify_one();
+        }, &notification);
+        c4queryobs_setEnabled(observer, true);
+
+        InterruptHandler interruptHandler;
+        auto lastModTime = dbModTime();
+        while (!InterruptHandler::interrupted()) {
+            bool changed;
+            {
+                unique_lock<mutex> lock(notification.mutex);
+                notification.cond.wait_for(lock, chrono::milliseconds(250),
+                                           [&]{return notification.changed;});
+                changed = notification.changed;
+                notification.changed = false;
+            }
+            if (changed) {
+                c4::ref<C4QueryEnumerator> newE = c4queryobs_getEnumerator(observer, true, &error);
+                if (newE) {
+                    e = std::move(newE);
+                    display(e, "observer");
+                    lastModTime = dbModTime();
+                } else if (error.code) {
+                    errorOccurred("refreshing query", error);
+                }
+            } else if (auto modTime = dbModTime(); modTime != lastModTime) {
+                lastModTime = modTime;
+                // c4queryenum_refresh returns null if the results haven't changed:
+                c4::ref<C4QueryEnumerator> newE = c4queryenum_refresh(e, &error);
+                if (newE) {
+                    e = std::move(newE);
+                    display(e, "external commit");
+                } else if (error.code) {
+                    fail("refreshing query", error);
                 }
-                ++col;
             }
         }
-        if (error.code || !c4queryenum_restart(e, &error))
-            fail("running query", error);
-        if (nRows == 0) {
-            cout << "(No results)\n";
+        observer = nullptr;
+        c4query_setParameters(query, nullslice);
+    }
+
+
+    // The latest modification time of the database's SQLite files. Every commit, by any process,
+    // updates the WAL file.
+    filesystem::file_time_type dbModTime() {
+        string dir(alloc_slice(c4db_getPath(_db)));
+        filesystem::file_time_type latest {};
+        for (const char *file : {"db.sqlite3", "db.sqlite3-wal"}) {
+            std::error_code ec;
+            auto time = filesystem::last_write_time(filesystem::path(dir) / file, ec);
+            if (!ec)
+                latest = max(latest, time);
+        }
+        return latest;
+    }
+
+
+    // Runs the query once with each parameter set in the `--params-file`, on up to `--jobs`
+    // read-only connections at once. Each row is prefixed with the line number of its parameters.
+    void runBatch(C4Query *query, const string &queryStr, unsigned queryStartPos) {
+        vector<unsigned> lines;
+        vector<alloc_slice> jsonParams = readParamsFile(_paramsFile, &lines);
+        vector<BatchQuery::ParamSet> paramSets;
+        paramSets.reserve(jsonParams.size());
+        vector<string> lineErrors;
+        for (size_t i = 0; i < jsonParams.size(); ++i) {
+            // A bad line is skipped and reported after the results, like a failed run:
+            if (!Doc::fromJSON(jsonParams[i], nullptr).asDict()) {
+                lineErrors.push_back("line " + to_string(lines[i])
+                                     + ": query parameters must be a JSON object");
+                continue;
+            }
+            paramSets.push_back({queryParameters(jsonParams[i]), lines[i]});
+        }
+        jsonParams.clear();
+        if (paramSets.empty()) {
+            for (auto &message : lineErrors)
+                errorOccurred(message);
+            return;
+        }
+
+        // Compile the query once per connection:
+        auto nJobs = unsigned(min(size_t(_jobs), paramSets.size()));
+        vector<BatchQuery::Connection> connections;
+        for (unsigned j = 0; j < nJobs; ++j) {
+            C4Error error;
+            size_t errorPos;
+            BatchQuery::Connection conn;
+            conn.db = openReadOnlyConnection(_db, &error);
+            if (!conn.db)
+                fail("opening a query connection to the database", error);
+            conn.query = compileQuery(_language, queryStr, &errorPos, &error, conn.db);
+            if (!conn.query)
+                failCompiling(queryStr, errorPos, queryStartPos, error);
+            connections.push_back(std::move(conn));
+        }
+
+        vector<string> titles = columnTitles(query);
+        titles.insert(titles.begin(), "_line");
+        BatchQuery rows(std::move(connections), std::move(paramSets));
+        writeResults(titles, rows);
+        for (auto &message : lineErrors)
+            errorOccurred(message);
+        for (auto &message : rows.errors())
+            errorOccurred(message);
+    }
+
+
+    // Runs the query on every database in `dbPaths`, combining the results.
+    void runFederated(const vector<string> &dbPaths, const string &queryStr,
+                      unsigned queryStartPos, slice afterParams)
+    {
+        // Compile the query on the first database, to check it and to get the column titles:
+        auto [dir, name] = splitDBPath(dbPaths[0]);
+        C4DatabaseConfig2 config = {slice(dir), kC4DB_ReadOnly};
+        C4Error error;
+        c4::ref<C4Database> db = c4db_openNamed(slice(name), &config, &error);
+        if (!db)
+            fail("opening database " + dbPaths[0], error);
+        size_t errorPos;
+        c4::ref<C4Query> query = compileQuery(_language, queryStr, &errorPos, &error, db);
+        if (!query)
+            failCompiling(queryStr, errorPos, queryStartPos, error);
+        if (_explain) {
+            cout << alloc_slice(c4query_explain(query));
             return;
         }
+        vector<string> titles = columnTitles(query);
+        titles.insert(titles.begin(), "_db");
+        db = nullptr;
+
+        // A LIMIT or OFFSET in the query itself applies to the combined results, like `--limit`
+        // and `--offset`, so it's taken out of the query each database runs. (compileQuery has
+        // already made sure they aren't both given.)
+        string dbQueryStr = queryStr;
+        uint64_t offset = _offset;
+        int64_t limit = _limit;
+        if (auto clauses = N1QLClauses::parse(queryStr);
+                clauses && (!clauses->limit.empty() || !clauses->offset.empty())) {
+            auto number = [&](const string &clause) -> int64_t {
+                char *end;
+                long long n = strtoll(clause.c_str(), &end, 10);
+                if (clause.empty() || *end != '\0' || n < 0)
+                    failMisuse("With --dbs, the query's LIMIT and OFFSET must be numbers");
+                return n;
+            };
+            if (!clauses->limit.empty())
+                limit = number(clauses->limit);
+            if (!clauses->offset.empty())
+                offset = uint64_t(number(clauses->offset));
+            clauses->limit.clear();
+            clauses->offset.clear();
+            dbQueryStr = clauses->toString();
+        }
+
+        // Each database has to return enough rows to fill the combined page by itself; the
+        // global offset and limit are applied to the merged results.
+        FederatedQuery::Options options;
+        options.jobs = _jobs;
+        options.descending = _cursorDescending;
+        alloc_slice params;
+        if (offset > 0 || limit >= 0) {
+            dbQueryStr += " LIMIT $limit OFFSET $offset";
+            options.offset = int64_t(offset);
+            options.limit = limit;
+            params = queryParameters(afterParams, 0, (limit >= 0) ? int64_t(offset) + limit : -1);
+        } else {
+            params = queryParameters(afterParams);
+        }
+
+        FederatedQuery rows(dbPaths, dbQueryStr, params, options);
+        writeResults(titles, rows);
+        for (auto &message : rows.errors())
+            errorOccurred(message);
+    }
 
-        // Subroutine that writes a column:
-        auto writeCol = [&](slice s, int align) {
-            string pad(widths[col] - s.size, ' ');
-            if (align < 0)
-                cout << pad;
-            cout << s;
-            if (col < nCols-1) {
-                if (align > 0)
-                    cout << pad;
-                cout << ' ';
+
+    // Expands a glob pattern into the paths of the databases it matches.
+    vector<string> matchingDatabases(const string &pattern) {
+#ifdef _MSC_VER
+        fail("--dbs is not supported on Windows");
+#else
+        glob_t matches;
+        vector<string> paths;
+        if (glob(pattern.c_str(), GLOB_MARK, nullptr, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; ++i) {
+                string path = matches.gl_pathv[i];
+                if (hasSuffix(path, ".cblite2/") || hasSuffix(path, ".cblite2"))
+                    paths.push_back(path);
             }
-        };
+        }
+        globfree(&matches);
+        if (paths.empty())
+            fail("No databases match " + pattern);
+        return paths;
+#endif
+    }
 
-        // Write the column titles:
-        if (nCols > 1) {
-            cout << ansiBold();
-            for (col = 0; col < nCols; ++col)
-                writeCol(c4query_columnTitle(query, col), 1);
-            cout << "\n";
-            for (col = 0; col < nCols; ++col)
-                cout << string(widths[col], '_') << ' ';
-            cout << ansiReset() << "\n";
+
+    // The result column titles, minus the hidden keyset-paging columns.
+    vector<string> columnTitles(C4Query *query) {
+        unsigned nCols = c4query_columnCount(query) - _cursorColumns;
+        vector<string> titles;
+        for (unsigned col = 0; col < nCols; ++col)
+            titles.emplace_back(slice(c4query_columnTitle(query, col)));
+        return titles;
+    }
+
+
+    // Writes the rows in the chosen output format. Returns the number of rows.
+    uint64_t writeResults(const vector<string> &titles, QueryRows &rows) {
+        Format format = _format.value_or(_prettyPrint ? Format::Table : Format::JSON);
+        if (format == Format::Table && !_outPath.empty())
+            format = Format::JSON;
+        if (format == Format::Table)
+            return displayQueryAsTable(titles, rows);
+        unique_ptr<OutputSink> file;
+        if (!_outPath.empty())
+            file = make_unique<OutputSink>(_outPath);
+        OutputSink &out = file ? *file : OutputSink::console();
+        uint64_t nRows = writeQueryResults(titles, rows, format, out);
+        out.flush();
+        return nRows;
+    }
+
+
+    // Sets up keyset pagination: adds the query's ORDER BY terms as hidden result columns, so the
+    // last row's values can be printed as the cursor for the next page, and if `--after` has
+    // values, adds a WHERE condition to skip to the rows after them. Returns the parameters for
+    // that. Paging appends `META().id` to the ORDER BY, so that rows that tie on the other terms
+    // aren't skipped; a query whose rows don't each have a doc ID, because of GROUP BY or a
+    // JOIN, can't be paged. (Extra columns would change which rows a SELECT DISTINCT considers
+    // duplicates, so such a query can't be paged or merged by `--dbs` either.)
+    alloc_slice addKeysetPaging(string &queryStr, bool federated) {
+        optional<N1QLClauses> clauses;
+        if (_language == kC4N1QLQuery)
+            clauses = N1QLClauses::parse(queryStr);
+        if (!clauses || clauses->orderBy.empty()) {
+            if (!_after.empty())
+                failMisuse("--after requires a N1QL query with an ORDER BY clause");
+            return nullslice;
         }
+        if (clauses->isDistinct()) {
+            if (!_after.empty())
+                failMisuse("--after can't be used with SELECT DISTINCT");
+            if (federated)
+                failMisuse("--dbs can't merge sorted SELECT DISTINCT results");
+            return nullslice;
+        }
+        // An alias can't be used in the SELECT list that defines it:
+        clauses->resolveOrderAliases();
 
-        // Write the rows:
-        nRows = 0;
-        while (c4queryenum_next(e, &error)) {
-            // Write a result row:
+        if (!_after.empty()) {
+            if (federated)
+                failMisuse("--after can't be used with --dbs, since a doc ID isn't unique "
+                           "across databases");
+            if (!clauses->addIDOrder())
+                failMisuse("--after can't be used with GROUP BY or JOIN, since the rows don't "
+                           "each have a unique doc ID to sort by");
+        }
+
+        alloc_slice params;
+        if (!_after.empty()) {
+            // An empty array starts at the first page:
+            Doc after = Doc::fromJSON(_after, nullptr);
+            Array values = after.asArray();
+            if (!values || (!values.empty() && values.count() != clauses->orderBy.size()))
+                failMisuse(stringprintf("--after must be [] or a JSON array of %zu ORDER BY "
+                                        "values, the last being the doc ID",
+                                        clauses->orderBy.size()));
+            // A NULL (or MISSING, which the cursor shows as null) value needs its own condition:
+            vector<bool> unvalued;
+            for (Array::iterator i(values); i; ++i)
+                unvalued.push_back(i.value().type() == kFLNull || i.value().type() == kFLUndefined);
+            if (!values.empty())
+                clauses->addWhere(clauses->afterCondition("after_", unvalued));
+            JSONEncoder enc;
+            enc.beginDict();
+            unsigned n = 0;
+            for (Array::iterator i(values); i; ++i) {
+                enc.writeKey("after_" + to_string(n++));
+                enc.writeValue(i.value());
+            }
+            enc.endDict();
+            params = enc.finish();
+        }
+
+        for (size_t n = 0; n < clauses->orderBy.size(); ++n)
+            clauses->what += ", " + clauses->orderBy[n].expression + " AS `_cursor" + to_string(n) + "`";
+        _cursorColumns = unsigned(clauses->orderBy.size());
+        for (auto &term : clauses->orderBy)
+            _cursorDescending.push_back(term.descending);
+        queryStr = clauses->toString();
+        return params;
+    }
+
+
+    // Prints the `--after` value that will return the next page: the last row's ORDER BY values,
+    // which are its last columns.
+    void printCursor(Array::iterator i) {
+        for (auto skip = i.count() - _cursorColumns; skip > 0; --skip)
+            ++i;
+        JSONEncoder enc;
+        enc.beginArray();
+        for (; i; ++i)
+            enc.writeValue(i.value());
+        enc.endArray();
+        cerr << "(Next page: --after " << enc.finish() << ")\n";
+    }
+
+
+    // Reports a query compilation error, pointing to its position in the query string.
+    void failCompiling(const string &queryStr, size_t errorPos, unsigned queryStartPos,
+                       C4Error error)
+    {
+        if (error.domain == LiteCoreDomain && error.code == kC4ErrorInvalidQuery) {
+            if (interactive()) {
+                errorPos += queryStartPos;
+            } else {
+                cerr << queryStr << "\n";
+            }
+            cerr << string(errorPos, ' ') << "^\n";
+            alloc_slice errorMessage = c4error_getMessage(error);
+            fail(string(errorMessage));
+        } else {
+            fail("compiling query", error);
+        }
+    }
+
+
+    // Returns the query parameters: the `--offset` and `--limit` values, if given, plus the
+    // properties of the JSON dict `extra` if it's not null.
+    alloc_slice queryParameters(slice extra = nullslice) {
+        return queryParameters(extra, _offset, _limit, (_offset > 0 || _limit >= 0));
+    }
+
+    // Same, but with explicit `offset` and `limit` values, which are always included.
+    alloc_slice queryParameters(slice extra, uint64_t offset, int64_t limit,
+                                bool offsetLimit = true)
+    {
+        if (!offsetLimit && !extra)
+            return nullslice;
+        JSONEncoder enc;
+        enc.beginDict();
+        if (extra) {
+            Doc doc = Doc::fromJSON(extra, nullptr);
+            if (!doc.asDict())
+                fail("Query parameters must be a JSON object: " + string(extra));
+            for (Dict::iterator i(doc.asDict()); i; ++i) {
+                if (offsetLimit && (i.keyString() == "offset"_sl || i.keyString() == "limit"_sl))
+                    continue;
+                enc.writeKey(i.keyString());
+                enc.writeValue(i.value());
+            }
+        }
+        if (offsetLimit) {
+            enc.writeKey("offset"_sl);
+            enc.writeUInt(offset);
+            enc.writeKey("limit"_sl);
+            enc.writeInt(limit >= 0 ? limit : INT64_MAX);
+        }
+        enc.endDict();
+        return enc.finish();
+    }
+
+
+    // Reads a file of query parameter sets, one JSON object per line. Blank lines are skipped.
+    // If `lineNumbers` is given, the (1-based) line number of each set is added to it.
+    vector<alloc_slice> readParamsFile(const string &path, vector<unsigned> *lineNumbers = nullptr) {
+        ifstream in(path);
+        if (!in)
+            fail("Couldn't open " + path);
+        vector<alloc_slice> paramSets;
+        string line;
+        unsigned lineNo = 0;
+        while (getline(in, line)) {
+            ++lineNo;
+            if (line.find_first_not_of(" \t\r") != string::npos) {
+                paramSets.emplace_back(line);
+                if (lineNumbers)
+                    lineNumbers->push_back(lineNo);
+            }
+        }
+        if (paramSets.empty())
+            fail(path + " contains no parameter sets");
+        return paramSets;
+    }
+
+
+    enum class Format {Table, JSON, NDJSON, CSV, TSV};
+
+    void formatFlag() {
+        string name = nextArg("output format");
+        if (name == "table")        _format = Format::Table;
+        else if (name == "json")    _format = Format::JSON;
+        else if (name == "ndjson")  _format = Format::NDJSON;
+        else if (name == "csv")     _format = Format::CSV;
+        else if (name == "tsv")     _format = Format::TSV;
+        else failMisuse("Unknown output format '" + name + "'; use table, json, ndjson, csv or tsv");
+    }
+
+
+    // Writes the results in one of the machine-readable formats. Everything goes through one
+    // buffered OutputSink, and the JSON formats reuse one encoder for every row. Without an
+    // explicit `--format`, or with `--json5`, JSON rows are spaced as they always have been, like
+    // `{"a": 1, "b": 2}`; `--format json` and `ndjson` write them compactly.
+    uint64_t writeQueryResults(const vector<string> &titles, QueryRows &rows, Format format,
+                               OutputSink &out) {
+        auto nCols = unsigned(titles.size());
+        bool spaced = (format == Format::JSON && (!_format || _json5));
+
+        bool json = (format == Format::JSON || format == Format::NDJSON);
+        char separator = (format == Format::CSV) ? ',' : '\t';
+        if (format == Format::JSON) {
+            out.write('[');
+        } else if (!json) {
+            for (unsigned col = 0; col < nCols; ++col) {
+                if (col > 0)
+                    out.write(separator);
+                writeField(titles[col], format, out);
+            }
+            out.write('\n');
+        }
+
+        JSONEncoder enc;
+        uint64_t nRows = 0;
+        while (rows.next()) {
+            uint64_t missing = rows.missingColumns();
+            if (json) {
+                if (format == Format::JSON && nRows > 0)
+                    out.write(",\n ");
+                if (spaced)
+                    writeSpacedJSONRow(rows, titles, out);
+                else {
+                    enc.beginDict();
+                    unsigned col = 0;
+                    for (Array::iterator i = rows.columns(); i && col < nCols; ++i, ++col) {
+                        if (!(missing & (1ull<<col))) {
+                            enc.writeKey(titles[col]);
+                            enc.writeValue(i.value());
+                        }
+                    }
+                    enc.endDict();
+                    out.write(enc.finish());
+                    enc.reset();
+                }
+                if (format == Format::NDJSON)
+                    out.write('\n');
+            } else {
+                unsigned col = 0;
+                for (Array::iterator i = rows.columns(); i && col < nCols; ++i, ++col) {
+                    if (col > 0)
+                        out.write(separator);
+                    if (!(missing & (1ull<<col)))
+                        writeFieldValue(i.value(), format, out);
+                }
+                out.write('\n');
+            }
             ++nRows;
-            col = 0;
-            for (Array::iterator i(e->columns); i; ++i) {
-                alloc_slice json;
-                if (!(e->missingColumns & (1<<col))) {
-                    auto type = i.value().type();
-                    if (type == kFLString)
-                        writeCol(i.value().asString(), 1);
-                    else
-                        writeCol(i.value().toJSON(_json5, true),
-                                 (type == kFLNumber ? -1 : 1));
+        }
+        if (format == Format::JSON)
+            out.write("]\n");
+        return nRows;
+    }
+
+
+    void writeSpacedJSONRow(QueryRows &rows, const vector<string> &titles, OutputSink &out) {
+        out.write('{');
+        unsigned col = 0, n = 0;
+        uint64_t missing = rows.missingColumns();
+        for (Array::iterator i = rows.columns(); i && col < titles.size(); ++i, ++col) {
+            if (missing & (1ull<<col))
+                continue;
+            if (n++)
+                out.write(", ");
+            const string &title = titles[col];
+            if (_json5 && canBeUnquotedJSON5Key(title)) {
+                out.write(title);
+            } else {
+                out.write('"');
+                out.write(title);
+                out.write('"');
+            }
+            out.write(": ");
+            out.write(i.value().toJSON(_json5, true));
+        }
+        out.write('}');
+    }
+
+
+    // Writes a column value as a CSV or TSV field. Numbers are formatted without allocating;
+    // nulls are empty; arrays and dicts are written as JSON.
+    static void writeFieldValue(Value value, Format format, OutputSink &out) {
+        switch (value.type()) {
+            case kFLNull:
+                break;
+            case kFLBoolean:
+                out.write(value.asBool() ? "true" : "false");
+                break;
+            case kFLNumber:
+                if (!value.isInteger())
+                    out.writeDouble(value.asDouble());
+                else if (value.isUnsigned())
+                    out.writeUInt(value.asUnsigned());
+                else
+                    out.writeInt(value.asInt());
+                break;
+            case kFLString:
+                writeField(value.asString(), format, out);
+                break;
+            default:
+                writeField(value.toJSON(false, true), format, out);
+                break;
+        }
+    }
+
+
+    // Writes text as a CSV field (quoted if necessary, per RFC 4180) or a TSV field (with tabs,
+    // newlines and backslashes escaped as `\t`, `\n`, `\r`, `\\`.)
+    static void writeField(slice text, Format format, OutputSink &out) {
+        if (format == Format::CSV) {
+            bool quote = false;
+            for (auto c : text) {
+                if (c == ',' || c == '"' || c == '\n' || c == '\r') {
+                    quote = true;
+                    break;
+                }
+            }
+            if (!quote) {
+                out.write(text);
+                return;
+            }
+            out.write('"');
+            for (auto c : text) {
+                if (c == '"')
+                    out.write('"');
+                out.write(char(c));
+            }
+            out.write('"');
+        } else {
+            for (auto c : text) {
+                switch (c) {
+                    case '\t': out.write("\\t"); break;
+                    case '\n': out.write("\\n"); break;
+                    case '\r': out.write("\\r"); break;
+                    case '\\': out.write("\\\\"); break;
+                    default:   out.write(char(c)); break;
                 }
-                ++col;
             }
-            cout << "\n";
         }
-        if (error.code)
-            fail("running query", error);
+    }
+
+
+    uint64_t displayQueryAsTable(const vector<string> &titles, QueryRows &rows) {
+        auto nCols = unsigned(titles.size());
+        TableWriter table(titles);
+
+        while (rows.next()) {
+            TableWriter::Row row(nCols);
+            unsigned col = 0;
+            uint64_t missing = rows.missingColumns();
+            for (Array::iterator i = rows.columns(); i && col < nCols; ++i, ++col) {
+                if (missing & (1ull<<col))
+                    continue;
+                auto type = i.value().type();
+                if (type == kFLString)
+                    row[col].text = string(i.value().asString());
+                else
+                    row[col].text = string(i.value().toJSON(_json5, true));
+                row[col].alignRight = (type == kFLNumber);
+            }
+            table.addRow(std::move(row));
+        }
+        table.finish();
+        return table.rowCount();
     }
 
 
     C4Query* compileQuery(C4QueryLanguage language, string queryStr,
-                                      size_t *outErrorPos, C4Error *outError)
+                          size_t *outErrorPos, C4Error *outError, C4Database *db = nullptr)
     {
         if (language == kC4JSONQuery) {
             // Convert JSON5 to JSON and detect JSON syntax errors:
@@ -283,14 +1025,24 @@ public:
                 json << "{\"WHERE\": " << queryJSON;
             else
                 json << slice(queryJSON.buf, queryJSON.size - 1);
-            if (_offset > 0 || _limit >= 0)
+            if (usesPagingParams())
                 json << ", \"OFFSET\": [\"$offset\"], \"LIMIT\":  [\"$limit\"]";
             json << "}";
             queryStr = json.str();
+        } else if (usesPagingParams()) {
+            // Pass OFFSET/LIMIT as parameters too, so the compiled query can be reused:
+            // (Only the query's own top-level clauses count, not a LIMIT in a subquery, nor a
+            // property or string that happens to be named `limit`.)
+            auto clauses = N1QLClauses::parse(queryStr);
+            if (clauses && (!clauses->limit.empty() || !clauses->offset.empty()))
+                failMisuse("--offset and --limit can't be used with a query that has LIMIT or OFFSET");
+            queryStr += " LIMIT $limit OFFSET $offset";
         }
 
+        if (!db)
+            db = _db;
         int pos;
-        auto query = c4query_new2(_db, language, slice(queryStr), &pos, outError);
+        auto query = c4query_new2(db, language, slice(queryStr), &pos, outError);
         if (!query && outErrorPos)
             *outErrorPos = pos;
         return query;
@@ -481,12 +1233,163 @@ public:
         }
     }
 
-private:
+protected:
     C4QueryLanguage         _language;
     bool                    _explain {false};
+    bool                    _analyze {false};
+    bool                    _watch {false};
+    optional<double>        _timeout;
+    bool                    _pageInBackground {false};
+    optional<Format>        _format;
+    string                  _outPath;
+    string                  _after;
+    unsigned                _cursorColumns {0};
+    vector<bool>            _cursorDescending;
+    string                  _dbsPattern;
+    unsigned                _jobs {defaultParallelism()};
+    string                  _paramsFile;
+    string                  _into;
+    string                  _idColumn;
+    bool                    _refresh {false};
 };
 
 
+/** The `bench` command: compiles a query once, runs it repeatedly, and reports the latencies
+    as JSON, so they can be compared before and after index changes. */
+class BenchCommand : public QueryCommand {
+public:
+    BenchCommand(CBLiteTool &parent)
+    :QueryCommand(parent, kC4JSONQuery)
+    { }
+
+
+    void usage() override {
+        writeUsageCommand("bench", true, "QUERY");
+        cerr <<
+        "  Runs a query many times and reports its latency percentiles, as JSON.\n"
+        "    --runs N :           Number of timed runs [default: 100]\n"
+        "    --warmup N :         Number of untimed runs first [default: 5]\n"
+        "    --params-file FILE : Query parameters, one JSON object per line; runs cycle through them\n"
+        "    --offset N :         Skip first N rows\n"
+        "    --limit N :          Stop after N rows\n"
+        "    --explain :          Include the query plan in the results\n"
+        "  " << it("QUERY") << " : LiteCore JSON or N1QL query, including the 'SELECT'\n";
+        if (interactive())
+            cerr << "    NOTE: Do not quote the query string, just give it literally.\n";
+    }
+
+
+    void runSubcommand() override {
+        string paramsFile;
+        processFlags({
+            {"--runs",        [&]{_runs = parseNextArg<unsigned>("number of runs", 1);}},
+            {"--warmup",      [&]{_warmup = parseNextArg<unsigned>("number of warmup runs", 0);}},
+            {"--params-file", [&]{paramsFile = nextArg("parameters file");}},
+            {"--explain",     [&]{_explain = true;}},
+            {"--limit",       [&]{limitFlag();}},
+            {"--offset",      [&]{offsetFlag();}},
+        });
+        openDatabaseFromNextArg();
+        string queryStr = restOfInput("query string");
+        if (queryStr[0] != '{' && queryStr[0] != '[')
+            _language = kC4N1QLQuery;
+
+        vector<alloc_slice> paramSets;
+        if (!paramsFile.empty()) {
+            for (auto &json : readParamsFile(paramsFile))
+                paramSets.push_back(queryParameters(json));
+        } else {
+            paramSets.push_back(queryParameters());
+        }
+
+        // Compile:
+        C4Error error;
+        size_t errorPos;
+        Stopwatch st;
+        c4::ref<C4Query> query = compileQuery(_language, queryStr, &errorPos, &error);
+        double compileTime = st.elapsed();
+        if (!query) {
+            // In interactive mode the query follows the prompt and the command name, as in `select`:
+            unsigned queryStartPos = 9 + 6;  // length of "(cblite) " + "bench "
+            failCompiling(queryStr, errorPos, queryStartPos, error);
+        }
+
+        // Run:
+        vector<double> times;
+        times.reserve(_runs);
+        uint64_t totalRows = 0;
+        for (unsigned i = 0; i < _warmup + _runs; ++i) {
+            slice params = paramSets[i % paramSets.size()];
+            st.reset();
+            c4::ref<C4QueryEnumerator> e = c4query_run(query, params, &error);
+            if (!e)
+                fail("running query", error);
+            uint64_t nRows = 0;
+            while (c4queryenum_next(e, &error))
+                ++nRows;
+            if (error.code)
+                fail("running query", error);
+            double time = st.elapsed();
+            if (i >= _warmup) {
+                times.push_back(time);
+                totalRows += nRows;
+            }
+        }
+
+        // Report:
+        double totalTime = 0;
+        for (double t : times)
+            totalTime += t;
+        sort(times.begin(), times.end());
+        auto percentile = [&](double p) {
+            // Nearest-rank method:
+            size_t rank = size_t(ceil(p * times.size()));
+            return times[min(max(rank, size_t(1)), times.size()) - 1];
+        };
+
+        JSONEncoder enc;
+        enc.beginDict();
+        enc.writeKey("query");
+        enc.writeString(queryStr);
+        enc.writeKey("compileMs");
+        enc.writeDouble(compileTime * 1000);
+        enc.writeKey("runs");
+        enc.writeUInt(_runs);
+        enc.writeKey("warmup");
+        enc.writeUInt(_warmup);
+        enc.writeKey("paramSets");
+        enc.writeUInt(paramSets.size());
+        enc.writeKey("latencyMs");
+        enc.beginDict();
+        enc.writeKey("min");    enc.writeDouble(times.front() * 1000);
+        enc.writeKey("p50");    enc.writeDouble(percentile(0.50) * 1000);
+        enc.writeKey("p95");    enc.writeDouble(percentile(0.95) * 1000);
+        enc.writeKey("p99");    enc.writeDouble(percentile(0.99) * 1000);
+        enc.writeKey("max");    enc.writeDouble(times.back() * 1000);
+        enc.writeKey("mean");   enc.writeDouble(totalTime / times.size() * 1000);
+        enc.endDict();
+        enc.writeKey("rowsPerRun");
+        enc.writeDouble(double(totalRows) / times.size());
+        enc.writeKey("rowsPerSec");
+        enc.writeDouble(totalTime > 0 ? totalRows / totalTime : 0);
+        if (_explain) {
+            enc.writeKey("explain");
+            enc.writeString(alloc_slice(c4query_explain(query)));
+        }
+        enc.endDict();
+        cout << enc.finish() << "\n";
+    }
+
+private:
+    unsigned _runs {100};
+    unsigned _warmup {5};
+};
+
+
+CBLiteCommand* newBenchCommand(CBLiteTool &parent) {
+    return new BenchCommand(parent);
+}
+
 CBLiteCommand* newQueryCommand(CBLiteTool &parent) {
     return new QueryCommand(parent, kC4JSONQuery);
 }
@@ -0,0 +1,539 @@
+//
+// QueryMaterializer.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "QueryMaterializer.hh"
+#include "LiteCoreTool.hh"
+#include "c4Query.h"
+#include "StringUtil.hh"
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <regex>
+
+using namespace std;
+using namespace litecore;
+using namespace fleece;
+
+
+static constexpr slice kStateStore = "cblite";
+
+// Number of writes per transaction:
+static constexpr unsigned kBatchSize = 10000;
+
+// Maximum number of values in a refresh query's `IN [...]` restriction:
+static constexpr size_t kMaxRestrictionSize = 500;
+
+
+[[noreturn]] static void fail(const string &what, C4Error error) {
+    LiteCoreTool::instance()->fail(what, error);
+}
+
+
+/** Writes documents and raw documents in a series of transactions of `kBatchSize` writes. */
+class QueryMaterializer::Writer {
+public:
+    explicit Writer(C4Database *db)
+    :_db(db)
+    {
+        begin();
+    }
+
+
+    // Creates or updates a document, unless it already has that body. Returns true if it wrote.
+    bool put(C4Collection *coll, slice docID, Dict body) {
+        C4Error error;
+        c4::ref<C4Document> doc = c4coll_getDoc(coll, docID, false, kDocGetCurrentRev, &error);
+        if (!doc)
+            fail("reading document \"" + string(docID) + "\"", error);
+        bool exists = (doc->flags & kDocExists) && !(doc->selectedRev.flags & kRevDeleted);
+        if (exists && Dict(c4doc_getProperties(doc)).isEqual(body))
+            return false;
+
+        SharedEncoder enc(c4db_getSharedFleeceEncoder(_db));
+        enc.writeValue(body);
+        alloc_slice encoded = enc.finish();
+        doc = c4doc_update(doc, encoded, 0, &error);
+        if (!doc)
+            fail("saving document \"" + string(docID) + "\"", error);
+        wrote();
+        return true;
+    }
+
+
+    // Deletes a document, if it exists. Returns true if it did.
+    bool remove(C4Collection *coll, slice docID) {
+        C4Error error;
+        c4::ref<C4Document> doc = c4coll_getDoc(coll, docID, true, kDocGetCurrentRev, &error);
+        if (!doc || (doc->selectedRev.flags & kRevDeleted))
+            return false;
+        doc = c4doc_update(doc, nullslice, kRevDeleted, &error);
+        if (!doc)
+            fail("deleting document \"" + string(docID) + "\"", error);
+        wrote();
+        return true;
+    }
+
+
+    // Writes a raw document, or deletes it if `body` is null.
+    void putRaw(slice store, slice key, slice body) {
+        C4Error error;
+        if (!c4raw_put(_db, store, key, nullslice, body, &error))
+            fail("saving materialization state", error);
+        wrote();
+    }
+
+
+    void commit() {
+        C4Error error;
+        if (!_t->commit(&error))
+            fail("committing transaction", error);
+        _t.reset();
+    }
+
+private:
+    void begin() {
+        C4Error error;
+        _t = make_unique<c4::Transaction>(_db);
+        if (!_t->begin(&error))
+            fail("starting transaction", error);
+        _size = 0;
+    }
+
+    void wrote() {
+        if (++_size >= kBatchSize) {
+            commit();
+            begin();
+        }
+    }
+
+    C4Database*                     _db;
+    unique_ptr<c4::Transaction>     _t;
+    unsigned                        _size = 0;
+};
+
+
+QueryMaterializer::QueryMaterializer(C4Database *db,
+                                     const string &queryStr,
+                                     const string &idColumn,
+                                     C4CollectionSpec target)
+:_db(db)
+,_queryStr(queryStr)
+,_idColumn(idColumn)
+{
+    auto tool = LiteCoreTool::instance();
+    auto clauses = N1QLClauses::parse(queryStr);
+    if (!clauses || clauses->from.empty())
+        tool->fail("--into requires a N1QL query with a FROM clause");
+    _clauses = *clauses;
+    _clauses.orderBy.clear();       // The order of the results doesn't matter
+
+    _source = N1QLClauses::parseSource(_clauses.from);
+    C4Error error;
+    if (!_source.collection.empty())
+        _sourceColl = c4db_getCollection(_db, {slice(_source.collection), slice(_source.scope)},
+                                         &error);
+    if (!_sourceColl)
+        tool->fail("--into requires a query whose FROM clause names a collection");
+
+    _target = c4db_createCollection(_db, target, &error);
+    if (!_target)
+        fail("creating collection " + string(slice(target.scope)) + "." + string(slice(target.name)),
+             error);
+    if (_target == _sourceColl)
+        tool->fail("The query can't be materialized into its own source collection");
+    _targetName = string(slice(target.scope)) + "." + string(slice(target.name));
+
+    // Find the ID column, and its expression:
+    c4::ref<C4Query> query = compile(_clauses);
+    unsigned nCols = c4query_columnCount(query);
+    if (_idColumn.empty()) {
+        _idColumn = string(slice(c4query_columnTitle(query, 0)));     // Default is the first column
+    } else {
+        for (_idIndex = 0; _idIndex < nCols; ++_idIndex) {
+            if (slice(c4query_columnTitle(query, _idIndex)) == slice(idColumn))
+                break;
+        }
+        if (_idIndex == nCols)
+            tool->fail("The query has no result column named '" + idColumn + "'");
+    }
+    auto expressions = _clauses.resultExpressions();
+    if (expressions.size() == nCols)
+        _idExpr = expressions[_idIndex];
+
+    static const regex kAggregate(R"(\b(COUNT|SUM|AVG|MIN|MAX|ARRAY_AGG)\s*\()", regex::icase);
+    if (!_clauses.groupBy.empty())
+        _mode = Mode::Grouped;
+    else if (regex_search(_clauses.what, kAggregate))
+        _mode = Mode::Whole;
+
+    if (!_clauses.limit.empty() || !_clauses.offset.empty()) {
+        _notRefreshable = "it has a LIMIT or OFFSET";
+    } else if (_idExpr.empty()) {
+        _notRefreshable = "the expression of its ID column couldn't be found";
+    } else if (_mode == Mode::Grouped) {
+        auto groupBy = N1QLClauses::splitList(_clauses.groupBy);
+        if (find(groupBy.begin(), groupBy.end(), _idExpr) == groupBy.end())
+            _notRefreshable = "its ID column isn't one of its GROUP BY expressions";
+    }
+}
+
+
+QueryMaterializer::Stats QueryMaterializer::run(bool refresh) {
+    _stats = {};
+    State state;
+    bool canRefresh = refresh && _notRefreshable.empty() && readState(state)
+                   && state.query == _queryStr && state.idColumn == _idColumn;
+    Writer writer(_db);
+    if (canRefresh)
+        this->refresh(writer, state.sequence);
+    else
+        fullRun(writer);
+    writer.commit();
+    return _stats;
+}
+
+
+void QueryMaterializer::fullRun(Writer &writer) {
+    // Get the sequence first, so changes made while the query runs will be picked up next time:
+    auto sequence = uint64_t(c4coll_getLastSequence(_sourceColl));
+
+    set<string> produced;
+    runInto(writer, _clauses, produced);
+
+    // Delete the documents from earlier runs that no longer correspond to a row:
+    C4Error error;
+    C4EnumeratorOptions options = {kC4IncludeNonConflicted};
+    c4::ref<C4DocEnumerator> e = c4coll_enumerateAllDocs(_target, &options, &error);
+    if (!e)
+        fail("enumerating documents", error);
+    vector<alloc_slice> obsolete;
+    while (c4enum_next(e, &error)) {
+        C4DocumentInfo info;
+        c4enum_getDocumentInfo(e, &info);
+        if (produced.find(string(slice(info.docID))) == produced.end())
+            obsolete.emplace_back(info.docID);
+    }
+    e = nullptr;
+    for (auto &docID : obsolete) {
+        if (writer.remove(_target, docID))
+            ++_stats.deleted;
+    }
+
+    if (_notRefreshable.empty() && _mode != Mode::Whole)
+        recordSources(writer, nullptr, nullptr, nullptr);
+    saveState(sequence);
+}
+
+
+void QueryMaterializer::refresh(Writer &writer, uint64_t since) {
+    _stats.refreshed = true;
+    auto sequence = uint64_t(c4coll_getLastSequence(_sourceColl));
+    if (sequence == since)
+        return;     // Nothing has changed
+
+    // Find the source documents that changed:
+    C4Error error;
+    set<string> changed;
+    C4EnumeratorOptions options = {kC4IncludeNonConflicted | kC4IncludeDeleted};
+    c4::ref<C4DocEnumerator> e = c4coll_enumerateChanges(_sourceColl, C4SequenceNumber(since),
+                                                         &options, &error);
+    if (!e)
+        fail("enumerating changes", error);
+    while (c4enum_next(e, &error)) {
+        C4DocumentInfo info;
+        c4enum_getDocumentInfo(e, &info);
+        if (uint64_t(info.sequence) > sequence)
+            break;      // changed after we started; the next refresh will get it
+        changed.emplace(slice(info.docID));
+    }
+    e = nullptr;
+    _stats.changedSources = changed.size();
+
+    if (_mode == Mode::Whole) {
+        // An aggregate over the whole collection is a single row; just recompute it:
+        _stats.refreshed = false;
+        fullRun(writer);
+        return;
+    }
+
+    // The keys (ID column values) of the rows the changed documents contributed to before, and
+    // contribute to now, are the ones affected:
+    set<string> affectedIDs, affectedLiterals;
+    string store = sourcesStore();
+    for (auto &docID : changed) {
+        C4RawDocument *raw = c4raw_get(_db, slice(store), slice(docID), &error);
+        if (!raw)
+            continue;
+        Doc keys = Doc::fromJSON(raw->body, nullptr);
+        c4raw_free(raw);
+        for (Array::iterator i(keys.asArray()); i; ++i) {
+            string id;
+            if (docIDFor(i.value(), id)) {
+                affectedIDs.insert(id);
+                affectedLiterals.insert(literal(i.value()));
+            }
+        }
+    }
+    recordSources(writer, &changed, &affectedIDs, &affectedLiterals);
+
+    // Recompute the affected rows. A row's key may come from other source documents too, which
+    // haven't changed (e.g. if the ID column isn't the docID), so in either mode the query is
+    // restricted to the affected keys, not to the changed documents:
+    vector<N1QLClauses> queries = restricted(_clauses, _idExpr, affectedLiterals);
+    set<string> produced;
+    for (auto &query : queries)
+        runInto(writer, query, produced);
+
+    // Delete the documents of affected rows that no longer exist:
+    for (auto &docID : affectedIDs) {
+        if (produced.find(docID) == produced.end() && writer.remove(_target, slice(docID)))
+            ++_stats.deleted;
+    }
+    saveState(sequence);
+}
+
+
+// Runs a query, writing a document for each row. Adds their IDs to `produced`.
+void QueryMaterializer::runInto(Writer &writer, const N1QLClauses &clauses, set<string> &produced) {
+    c4::ref<C4Query> query = compile(clauses);
+    unsigned nCols = c4query_columnCount(query);
+    vector<alloc_slice> titles;
+    for (unsigned col = 0; col < nCols; ++col)
+        titles.emplace_back(c4query_columnTitle(query, col));
+
+    C4Error error;
+    c4::ref<C4QueryEnumerator> e = c4query_run(query, nullslice, &error);
+    if (!e)
+        fail("running query", error);
+    Encoder enc;
+    while (c4queryenum_next(e, &error)) {
+        ++_stats.rows;
+        string docID;
+        Array::iterator i(e->columns);
+        if ((e->missingColumns & (1ull << _idIndex)) || !docIDFor(i[_idIndex], docID)) {
+            ++_stats.skipped;
+            continue;
+        }
+        enc.beginDict();
+        for (unsigned col = 0; i && col < nCols; ++i, ++col) {
+            if (col != _idIndex && !(e->missingColumns & (1ull << col))) {
+                enc.writeKey(titles[col]);
+                enc.writeValue(i.value());
+            }
+        }
+        enc.endDict();
+        Doc body = enc.finishDoc();
+        if (writer.put(_target, slice(docID), body.asDict()))
+            ++_stats.written;
+        produced.insert(std::move(docID));
+    }
+    if (error.code)
+        fail("running query", error);
+}
+
+
+// Records the keys of the rows each source document contributes to, as a raw document whose key
+// is the source's docID and whose body is a JSON array of keys. If `changed` is given, only those
+// source documents are updated, and their keys are added to `affectedIDs` and `affectedLiterals`.
+void QueryMaterializer::recordSources(Writer &writer, const set<string> *changed,
+                                      set<string> *affectedIDs, set<string> *affectedLiterals)
+{
+    string metaID = "META(" + _source.alias + ").id";
+    N1QLClauses sources;
+    sources.what = metaID + ", " + _idExpr;
+    sources.from = _clauses.from;
+    sources.where = _clauses.where;
+    sources.orderBy.push_back({metaID});     // so each document's rows are together
+
+    vector<N1QLClauses> queries;
+    if (changed) {
+        set<string> docIDLiterals;
+        for (auto &docID : *changed)
+            docIDLiterals.insert(literal(slice(docID)));
+        queries = restricted(sources, metaID, docIDLiterals);
+    } else {
+        queries.push_back(sources);
+    }
+
+    string store = sourcesStore();
+    set<string> recorded;
+    for (auto &clauses : queries) {
+        c4::ref<C4Query> query = compile(clauses);
+        C4Error error;
+        c4::ref<C4QueryEnumerator> e = c4query_run(query, nullslice, &error);
+        if (!e)
+            fail("running query", error);
+        JSONEncoder enc;
+        string current;
+        set<string> keys;
+        auto flush = [&] {
+            if (current.empty())
+                return;
+            enc.endArray();
+            writer.putRaw(slice(store), slice(current), enc.finish());
+            enc.reset();
+            recorded.insert(current);
+            keys.clear();
+        };
+        while (c4queryenum_next(e, &error)) {
+            Array::iterator i(e->columns);
+            slice docID = i[0].asString();
+            if (docID != slice(current)) {
+                flush();
+                current = string(docID);
+                enc.beginArray();
+            }
+            Value key = i[1];
+            string id;
+            if ((e->missingColumns & 2) || !docIDFor(key, id))
+                continue;
+            string lit = literal(key);
+            if (!keys.insert(lit).second)
+                continue;
+            enc.writeValue(key);
+            if (affectedIDs) {
+                affectedIDs->insert(id);
+                affectedLiterals->insert(lit);
+            }
+        }
+        if (error.code)
+            fail("running query", error);
+        flush();
+    }
+
+    // Changed documents that no longer contribute to any row:
+    if (changed) {
+        for (auto &docID : *changed) {
+            if (recorded.find(docID) == recorded.end())
+                writer.putRaw(slice(store), slice(docID), nullslice);
+        }
+    }
+}
+
+
+// Copies of a query that only return the rows where `expr` has one of the given values, each with
+// at most kMaxRestrictionSize of them.
+vector<N1QLClauses> QueryMaterializer::restricted(const N1QLClauses &clauses, const string &expr,
+                                                  const set<string> &literals)
+{
+    vector<N1QLClauses> queries;
+    string list;
+    size_t n = 0;
+    for (auto i = literals.begin(); i != literals.end(); ++i) {
+        list += (n ? ", " : "") + *i;
+        if (++n == kMaxRestrictionSize || next(i) == literals.end()) {
+            N1QLClauses query = clauses;
+            query.addWhere("(" + expr + ") IN [" + list + "]");
+            queries.push_back(std::move(query));
+            list.clear();
+            n = 0;
+        }
+    }
+    return queries;
+}
+
+
+C4Query* QueryMaterializer::compile(const N1QLClauses &clauses) {
+    string queryStr = clauses.toString();
+    C4Error error;
+    C4Query *query = c4query_new2(_db, kC4N1QLQuery, slice(queryStr), nullptr, &error);
+    if (!query)
+        fail("compiling query `" + queryStr + "`", error);
+    return query;
+}
+
+
+bool QueryMaterializer::readState(State &state) {
+    C4Error error;
+    C4RawDocument *raw = c4raw_get(_db, kStateStore, slice(stateKey()), &error);
+    if (!raw)
+        return false;
+    Doc doc = Doc::fromJSON(raw->body, nullptr);
+    c4raw_free(raw);
+    state.query = string(doc["query"].asString());
+    state.idColumn = string(doc["id"].asString());
+    state.sequence = doc["sequence"].asUnsigned();
+    return true;
+}
+
+
+void QueryMaterializer::saveState(uint64_t sequence) {
+    JSONEncoder enc;
+    enc.beginDict();
+    enc.writeKey("query");
+    enc.writeString(_queryStr);
+    enc.writeKey("id");
+    enc.writeString(_idColumn);
+    enc.writeKey("sequence");
+    enc.writeUInt(sequence);
+    enc.endDict();
+    C4Error error;
+    if (!c4raw_put(_db, kStateStore, slice(stateKey()), nullslice, enc.finish(), &error))
+        fail("saving materialization state", error);
+}
+
+
+string QueryMaterializer::stateKey() const {
+    return "into:" + _targetName;
+}
+
+
+// The raw store recording the source documents' keys. Its name can only contain letters,
+// digits and underscores, so other characters of the collection name are escaped.
+string QueryMaterializer::sourcesStore() const {
+    string name = "cblite_into_";
+    for (char c : _targetName) {
+        if (isalnum((unsigned char)c))
+            name += c;
+        else
+            name += stringprintf("_%02x", (unsigned char)c);
+    }
+    return name;
+}
+
+
+// The docID of the document for a row whose ID column is `key`: a string is used as-is, and a
+// number is converted to a string. Returns false for other types.
+bool QueryMaterializer::docIDFor(Value key, string &docID) {
+    if (key.type() == kFLString && key.asString().size > 0)
+        docID = string(key.asString());
+    else if (key.type() == kFLNumber)
+        docID = string(key.toJSON());
+    else
+        return false;
+    return true;
+}
+
+
+// A N1QL literal for a string or number.
+string QueryMaterializer::literal(Value value) {
+    if (value.type() == kFLString)
+        return literal(value.asString());
+    return string(value.toJSON());
+}
+
+
+string QueryMaterializer::literal(slice str) {
+    string result = "'";
+    for (char c : str) {
+        if (c == '\'')
+            result += '\'';
+        result += c;
+    }
+    return result + "'";
+}
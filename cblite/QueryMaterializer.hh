@@ -0,0 +1,106 @@
+//
+// QueryMaterializer.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "N1QLClauses.hh"
+#include "c4.hh"
+#include "fleece/Fleece.hh"
+#include <set>
+#include <string>
+#include <vector>
+
+
+/** Stores the results of a N1QL query as the documents of a collection, one per row, so they can
+    be looked up by key instead of running the query again. Each document's ID is the value of one
+    result column, and its properties are the other columns. A full run replaces the collection's
+    contents; documents that no longer correspond to a row are deleted.
+
+    To support refreshing, it also records the source collection's last sequence, and which
+    result documents each source document contributed to. A refresh only re-runs the query for
+    the rows (or, if the query has a GROUP BY, the groups) that the source documents changed
+    since then contribute to now or contributed to before, by restricting the ID column's
+    expression to those rows' keys. (Only changes to the first collection in the FROM clause are
+    tracked, not to JOINed ones.) */
+class QueryMaterializer {
+public:
+    struct Stats {
+        uint64_t    rows = 0;           // Result rows computed
+        uint64_t    written = 0;        // Documents created or updated
+        uint64_t    deleted = 0;        // Documents deleted
+        uint64_t    skipped = 0;        // Rows whose ID column isn't a string or number
+        uint64_t    changedSources = 0; // Source documents changed since the last run
+        bool        refreshed = false;  // False if it was a full run
+    };
+
+    /// Checks the query and finds its source collection; fails if it can't be materialized.
+    /// `db` must be writeable. If `idColumn` is empty, the first column is used.
+    QueryMaterializer(C4Database *db,
+                      const std::string &queryStr,
+                      const std::string &idColumn,
+                      C4CollectionSpec target);
+
+    /// Materializes the results. If `refresh` is true, and this query was materialized into the
+    /// same collection before, only the results affected by changes since then are recomputed.
+    Stats run(bool refresh);
+
+    /// If `refresh` can't be incremental, the reason; else empty.
+    const std::string& notRefreshableReason() const         {return _notRefreshable;}
+
+    /// The name of the column the docIDs come from.
+    const std::string& idColumn() const                     {return _idColumn;}
+
+private:
+    enum class Mode {PerDocument, Grouped, Whole};
+
+    struct State {
+        std::string query, idColumn;
+        uint64_t    sequence = 0;
+    };
+
+    class Writer;
+
+    bool readState(State&);
+    void saveState(uint64_t sequence);
+    void fullRun(Writer&);
+    void refresh(Writer&, uint64_t since);
+    C4Query* compile(const N1QLClauses&);
+    void runInto(Writer&, const N1QLClauses&, std::set<std::string> &produced);
+    void recordSources(Writer&, const std::set<std::string> *changed,
+                       std::set<std::string> *affectedIDs, std::set<std::string> *affectedLiterals);
+    static std::vector<N1QLClauses> restricted(const N1QLClauses&, const std::string &expr,
+                                               const std::set<std::string> &literals);
+    std::string stateKey() const;
+    std::string sourcesStore() const;
+
+    static bool docIDFor(fleece::Value key, std::string &docID);
+    static std::string literal(fleece::Value);
+    static std::string literal(fleece::slice str);
+
+    C4Database*             _db;
+    std::string             _queryStr, _idColumn;
+    N1QLClauses             _clauses;
+    N1QLClauses::Source     _source;
+    std::string             _idExpr;            // The ID column's expression
+    unsigned                _idIndex = 0;       // The ID column's index
+    Mode                    _mode = Mode::PerDocument;
+    std::string             _notRefreshable;
+    C4Collection*           _sourceColl = nullptr;
+    C4Collection*           _target = nullptr;
+    std::string             _targetName;
+    Stats                   _stats;
+};
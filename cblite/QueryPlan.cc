@@ -0,0 +1,125 @@
+//
+// QueryPlan.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "QueryPlan.hh"
+#include <map>
+#include <regex>
+#include <sstream>
+
+using namespace std;
+using namespace fleece;
+
+
+// Maps the aliases of the tables in the SQL's FROM clauses and JOINs to the tables' names, e.g.
+// `FROM "kv_default" AS _doc`. LiteCore always gives its tables aliases.
+static map<string,string> tableAliases(const string &sql) {
+    static const regex kAlias(R"(\b(?:FROM|JOIN)\s+("[^"]+"|\w+)\s+AS\s+("[^"]+"|\w+))",
+                              regex::icase);
+    auto unquote = [](string name) {
+        if (name.size() >= 2 && name.front() == '"')
+            name = name.substr(1, name.size() - 2);
+        return name;
+    };
+    map<string,string> aliases;
+    for (sregex_iterator i(sql.begin(), sql.end(), kAlias), end; i != end; ++i)
+        aliases.emplace(unquote((*i)[2]), unquote((*i)[1]));
+    return aliases;
+}
+
+
+// `c4query_explain` returns the SQL, a blank line, then one "id|parent|notused|detail" line per
+// plan step (the output of SQLite's EXPLAIN QUERY PLAN), then a blank line and the JSON query.
+// Before SQLite 3.36 a step names its table, as in "SCAN TABLE kv_default AS _doc"; since then
+// it names only the alias, as in "SCAN _doc", so that's looked up in the SQL.
+QueryPlan QueryPlan::parse(slice explanation) {
+    static const regex kStepLine(R"(^(\d+)\|(-?\d+)\|\d+\|\s*(.*)$)");
+    static const regex kTableStep(R"(^(SCAN|SEARCH)( TABLE)? (\S+)(.*)$)");
+
+    QueryPlan plan;
+    istringstream in{string(explanation)};
+    string line;
+    bool inSQL = true;
+    map<int, unsigned> depthOf;
+    map<string,string> aliases;
+    while (getline(in, line)) {
+        smatch m;
+        if (inSQL) {
+            if (line.empty())
+                inSQL = false;
+            else
+                plan.sql += (plan.sql.empty() ? "" : "\n") + line;
+        } else if (regex_match(line, m, kStepLine)) {
+            Step step;
+            step.id = stoi(m[1]);
+            step.parent = stoi(m[2]);
+            step.detail = m[3];
+            auto parent = depthOf.find(step.parent);
+            step.depth = (parent != depthOf.end()) ? parent->second + 1 : 0;
+            depthOf[step.id] = step.depth;
+
+            smatch t;
+            if (regex_match(step.detail, t, kTableStep)) {
+                step.table = t[3];
+                string rest = t[4];
+                if (!t[2].matched) {
+                    if (aliases.empty())
+                        aliases = tableAliases(plan.sql);
+                    if (auto i = aliases.find(step.table); i != aliases.end())
+                        step.table = i->second;
+                }
+                // A SCAN that doesn't use an index, of a collection (not an FTS or temp table):
+                step.fullScan = (t[1] == "SCAN" && rest.find("USING") == string::npos
+                                 && step.table.find("::") == string::npos
+                                 && step.table.compare(0, 3, "kv_") == 0);
+            }
+            step.tempBTree = (step.detail.find("TEMP B-TREE") != string::npos);
+            plan.steps.push_back(std::move(step));
+        } else if (!plan.steps.empty()) {
+            break;      // Reached the JSON query
+        }
+    }
+    return plan;
+}
+
+
+bool QueryPlan::hasFullScan() const {
+    for (auto &step : steps) {
+        if (step.fullScan)
+            return true;
+    }
+    return false;
+}
+
+
+optional<C4CollectionSpec> QueryPlan::collectionForTable(const string &table,
+                                                          string &scopeBuf, string &nameBuf)
+{
+    if (table == "kv_default")
+        return kC4DefaultCollectionSpec;
+    if (table.compare(0, 4, "kv_.") != 0)
+        return nullopt;
+    string path = table.substr(4);
+    if (auto dot = path.find('.'); dot != string::npos) {
+        scopeBuf = path.substr(0, dot);
+        nameBuf = path.substr(dot + 1);
+    } else {
+        scopeBuf = string(slice(kC4DefaultScopeID));
+        nameBuf = path;
+    }
+    return C4CollectionSpec{slice(nameBuf), slice(scopeBuf)};
+}
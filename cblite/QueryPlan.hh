@@ -0,0 +1,51 @@
+//
+// QueryPlan.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "c4.hh"
+#include <optional>
+#include <string>
+#include <vector>
+
+
+/** The output of `c4query_explain`, parsed: the translated SQL, and the steps of SQLite's
+    query plan, so that costly steps like full table scans can be found. */
+struct QueryPlan {
+    struct Step {
+        int         id = 0, parent = 0;
+        unsigned    depth = 0;          // Nesting level under parent steps
+        std::string detail;             // e.g. "SEARCH kv_default AS _doc USING INDEX byName (..)"
+        std::string table;              // Table scanned or searched, if any (not its alias)
+        bool        fullScan = false;   // Reads every row of a collection's table
+        bool        tempBTree = false;  // Sorts or de-duplicates rows in a temporary B-tree
+    };
+
+    std::string         sql;
+    std::vector<Step>   steps;
+
+    static QueryPlan parse(fleece::slice explanation);
+
+    /// True if any step is a full scan of a collection's table.
+    bool hasFullScan() const;
+
+    /// The collection stored in a LiteCore table like "kv_default" or "kv_.scope.coll",
+    /// or nullopt if it's not a collection's table.
+    static std::optional<C4CollectionSpec> collectionForTable(const std::string &table,
+                                                              std::string &scopeBuf,
+                                                              std::string &nameBuf);
+};
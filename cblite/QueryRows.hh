@@ -0,0 +1,61 @@
+//
+// QueryRows.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "LiteCoreTool.hh"
+#include "c4Query.h"
+#include "fleece/Fleece.hh"
+
+
+/** A sequence of query result rows, as consumed by QueryCommand's output code: either a single
+    query's enumerator, or the merged results of a query run on many databases. */
+class QueryRows {
+public:
+    virtual ~QueryRows() = default;
+
+    /// Moves to the next row. Returns false at the end.
+    virtual bool next() =0;
+
+    /// The current row's column values.
+    virtual fleece::Array::iterator columns() const =0;
+
+    /// Bit-set of the current row's columns whose values are MISSING.
+    virtual uint64_t missingColumns() const =0;
+};
+
+
+/** QueryRows from a C4QueryEnumerator. Fails if the query fails. */
+class EnumeratorRows : public QueryRows {
+public:
+    explicit EnumeratorRows(C4QueryEnumerator *e)    :_e(e) { }
+
+    bool next() override {
+        C4Error error;
+        if (c4queryenum_next(_e, &error))
+            return true;
+        if (error.code)
+            LiteCoreTool::instance()->fail("running query", error);
+        return false;
+    }
+
+    fleece::Array::iterator columns() const override    {return fleece::Array::iterator(_e->columns);}
+    uint64_t missingColumns() const override            {return _e->missingColumns;}
+
+private:
+    C4QueryEnumerator* _e;
+};
@@ -44,6 +44,7 @@ public:
         cout << "Rebuilding indexes ... ";
         cout.flush();
 
+        invalidateQueryCache();
         C4Error error;
         if (c4db_maintenance(_db, kC4Reindex, &error))
             cout << "done!\n";
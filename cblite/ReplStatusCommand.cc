@@ -0,0 +1,259 @@
+//
+// ReplStatusCommand.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "CBLiteCommand.hh"
+#include <iomanip>
+#include <optional>
+
+using namespace std;
+using namespace fleece;
+using namespace litecore;
+
+
+class ReplStatusCommand : public CBLiteCommand {
+public:
+
+    ReplStatusCommand(CBLiteTool &parent)
+    :CBLiteCommand(parent)
+    { }
+
+
+    void usage() override {
+        writeUsageCommand("replstatus", true);
+        cerr <<
+        "  Estimates how many changes haven't yet been pushed to each remote database this\n"
+        "  database has replicated with, per collection.\n"
+        "    --since SEQ : Scan changes after sequence SEQ instead of the replicator checkpoints\n"
+        "    --verbose or -v : Also list the checkpoints found\n"
+        "  For each remote and collection, only changes made since the replicator's checkpoint\n"
+        "  are scanned. If there's no checkpoint, the collection isn't scanned, but reported as\n"
+        "  having none; use --since 0 to scan all of its changes. A remote that's only ever\n"
+        "  been pulled from will show all local changes as pending.\n"
+        ;
+    }
+
+
+    void runSubcommand() override {
+        optional<uint64_t> since;
+        processFlags({
+            {"--since",   [&]{since = parseNextArg<uint64_t>("sequence");}},
+            {"--verbose", [&]{verboseFlag();}},
+            {"-v",        [&]{verboseFlag();}},
+        });
+        openDatabaseFromNextArg();
+        endOfArgs();
+
+        // Remote IDs are assigned consecutively starting at 1:
+        vector<alloc_slice> remotes;
+        for (C4RemoteID i = 1; true; ++i) {
+            alloc_slice addr(c4db_getRemoteDBAddress(_db, i));
+            if (!addr)
+                break;
+            remotes.push_back(addr);
+        }
+        if (remotes.empty()) {
+            cout << "This database has not replicated with any remote database.\n";
+            return;
+        }
+
+        C4UUID privateUUID = {};
+        if (since) {
+            cout << "Scanning changes after sequence " << *since << "\n";
+        } else {
+            C4UUID publicUUID;
+            C4Error error;
+            if (!c4db_getUUIDs(_db, &publicUUID, &privateUUID, &error))
+                fail("getting the database's UUIDs", error);
+        }
+
+        vector<CollectionName> collections;
+        if (_collectionName.empty())
+            collections = allCollections();
+        else
+            collections.emplace_back(collection()->getSpec());
+
+        // For each remote, the collections with pending changes or without a checkpoint:
+        vector<vector<Pending>> pending(remotes.size());
+        for (auto &coll : collections) {
+            // Each remote's changes are scanned from that remote's checkpoint of this collection;
+            // without one, there's nothing to scan from:
+            vector<optional<uint64_t>> sinces(remotes.size(), since);
+            if (!since) {
+                for (size_t r = 0; r < remotes.size(); ++r) {
+                    string id = checkpointID(privateUUID, remotes[r], coll);
+                    sinces[r] = checkpointSequence(id);
+                    if (verbose()) {
+                        cout << ansiDim() << nameOfCollection(coll) << " to REMOTE#" << (r + 1);
+                        if (sinces[r])
+                            cout << ": checkpoint " << id << " at sequence " << *sinces[r];
+                        else
+                            cout << ": no checkpoint " << id;
+                        cout << ansiReset() << "\n";
+                    }
+                }
+            }
+            vector<Pending> counts = scanCollection(coll, sinces);
+            for (size_t r = 0; r < remotes.size(); ++r) {
+                if (counts[r].docs > 0 || counts[r].noCheckpoint) {
+                    counts[r].collection = nameOfCollection(coll);
+                    pending[r].push_back(counts[r]);
+                }
+            }
+        }
+
+        for (size_t r = 0; r < remotes.size(); ++r) {
+            cout << ansiBold() << "[REMOTE#" << (r + 1) << "] " << remotes[r] << ansiReset() << "\n";
+            if (pending[r].empty()) {
+                cout << "    Up to date\n";
+                continue;
+            }
+            uint64_t totalDocs = 0, totalBytes = 0;
+            size_t nScanned = 0;
+            bool missingCheckpoints = false;
+            for (auto &p : pending[r]) {
+                if (p.noCheckpoint) {
+                    cout << "    " << left << setw(30) << p.collection << right
+                         << "  no checkpoint found\n";
+                    missingCheckpoints = true;
+                    continue;
+                }
+                writeLine(p.collection, p.docs, p.bytes);
+                totalDocs += p.docs;
+                totalBytes += p.bytes;
+                ++nScanned;
+            }
+            if (nScanned > 1)
+                writeLine("(total)", totalDocs, totalBytes);
+            if (missingCheckpoints)
+                cout << "    (Use --since 0 to count all changes of a collection without a "
+                        "checkpoint.)\n";
+        }
+    }
+
+
+private:
+    struct Pending {
+        string   collection;
+        uint64_t docs = 0;
+        uint64_t bytes = 0;
+        bool     noCheckpoint = false;  // Not scanned, since the replicator has no checkpoint
+    };
+
+
+    void writeLine(const string &name, uint64_t docs, uint64_t bytes) {
+        cout << "    " << left << setw(30) << name << right << setw(10) << docs << " docs   ";
+        writeSize(bytes);
+        cout << "\n";
+    }
+
+
+    /// Returns the local sequence recorded in a replicator checkpoint, or nullopt if there's no
+    /// such checkpoint. Every change at or below that sequence has already been handled by that
+    /// checkpoint's replicator.
+    optional<uint64_t> checkpointSequence(const string &checkpointID) {
+        // Checkpoints are raw docs whose JSON body has a "local" property holding the
+        // latest sequence the replicator has completely processed.
+        C4Error error;
+        C4RawDocument *raw = c4raw_get(_db, "checkpoints"_sl, slice(checkpointID), &error);
+        if (!raw)
+            return nullopt;
+        Doc body = Doc::fromJSON(raw->body, nullptr);
+        c4raw_free(raw);
+        Value local = body.asDict()["local"];
+        if (!local)
+            return nullopt;
+        return local.asUnsigned();
+    }
+
+
+    /// Derives the ID of the checkpoint a replicator uses for a collection and remote, the way
+    /// LiteCore's Checkpointer does: "cp-" plus the base64 SHA-1 digest of a Fleece array of the
+    /// local database's private UUID, the remote's address, and the collection if it isn't the
+    /// default one. (LiteCore's checkpoint docs don't record the remote or collection, so the
+    /// ID can't be matched any other way.) A replication with channels, docIDs or a filter has a
+    /// different ID, which won't be found; nor will any if LiteCore changes how it derives IDs.
+    /// Then the collection is reported as having no checkpoint.
+    string checkpointID(const C4UUID &privateUUID, slice remoteAddress, C4CollectionSpec spec) {
+        Encoder enc;
+        enc.beginArray();
+        enc.writeString(slice(&privateUUID, sizeof(privateUUID)));
+        enc.writeString(remoteAddress);
+        if (slice(spec.name) != slice(kC4DefaultCollectionName)
+                || slice(spec.scope) != slice(kC4DefaultScopeID))
+            enc.writeString(nameOfCollection(spec));
+        enc.endArray();
+        alloc_slice data = enc.finish();
+        // A blob key is the SHA-1 digest of the blob, and its string form is "sha1-" + base64:
+        C4BlobKey digest = c4blob_computeKey(data);
+        string digestStr(alloc_slice(c4blob_keyToString(digest)));
+        return "cp-" + digestStr.substr(5);
+    }
+
+
+    /// Scans the changes in a collection, and for each remote counts the docs changed after that
+    /// remote's sequence in `sinces` whose current revision isn't marked as current on the remote.
+    /// A remote without a sequence isn't counted, but marked as having no checkpoint.
+    vector<Pending> scanCollection(C4CollectionSpec spec, const vector<optional<uint64_t>> &sinces) {
+        size_t nRemotes = sinces.size();
+        vector<Pending> counts(nRemotes);
+        optional<uint64_t> since;
+        for (size_t r = 0; r < nRemotes; ++r) {
+            if (!sinces[r])
+                counts[r].noCheckpoint = true;
+            else if (!since || *sinces[r] < *since)
+                since = sinces[r];
+        }
+        if (!since)
+            return counts;
+        C4Collection *coll = _db->getCollection(spec);
+        if (!coll)
+            return counts;
+
+        C4Error error;
+        C4EnumeratorOptions options = {kC4IncludeNonConflicted | kC4IncludeDeleted};
+        c4::ref<C4DocEnumerator> e = c4coll_enumerateChanges(coll, C4SequenceNumber(*since),
+                                                             &options, &error);
+        if (!e)
+            fail("enumerating changes", error);
+        while (c4enum_next(e, &error)) {
+            C4DocumentInfo info;
+            c4enum_getDocumentInfo(e, &info);
+            // The remote ancestors are part of the revision metadata, so load all of it:
+            c4::ref<C4Document> doc = c4coll_getDoc(coll, info.docID, true, kDocGetAll, &error);
+            if (!doc)
+                fail("reading document " + string(slice(info.docID)), error);
+            for (size_t r = 0; r < nRemotes; ++r) {
+                if (!sinces[r] || uint64_t(info.sequence) <= *sinces[r])
+                    continue;
+                alloc_slice remoteRev(c4doc_getRemoteAncestor(doc, C4RemoteID(r + 1)));
+                if (remoteRev != slice(info.revID)) {
+                    ++counts[r].docs;
+                    counts[r].bytes += info.bodySize;
+                }
+            }
+        }
+        if (error.code)
+            fail("enumerating changes", error);
+        return counts;
+    }
+};
+
+
+CBLiteCommand* newReplStatusCommand(CBLiteTool &parent) {
+    return new ReplStatusCommand(parent);
+}
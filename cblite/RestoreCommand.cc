@@ -0,0 +1,229 @@
+//
+// RestoreCommand.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "CBLiteCommand.hh"
+#include "DeltaFile.hh"
+#include "Base64.hh"
+#include "Stopwatch.hh"
+#include <fstream>
+#include <memory>
+
+using namespace std;
+using namespace fleece;
+using namespace litecore;
+
+
+class RestoreCommand : public CBLiteCommand {
+public:
+
+    RestoreCommand(CBLiteTool &parent)
+    :CBLiteCommand(parent)
+    { }
+
+
+    void usage() override {
+        writeUsageCommand("restore", false, "DELTA [DELTA...]");
+        cerr <<
+        "  Applies incremental backups made by `backup --incremental` to a database restored from\n"
+        "  a full backup. Give the DELTA files in the order they were made. The database remembers\n"
+        "  which deltas it has applied, so later ones can be applied another time.\n"
+        ;
+    }
+
+
+    void runSubcommand() override {
+        openWriteableDatabaseFromNextArg();
+        vector<string> deltas;
+        do {
+            deltas.push_back(nextArg("delta file"));
+        } while (hasArgs());
+
+        State state = readState();
+        for (auto &path : deltas)
+            applyDelta(path, state);
+    }
+
+
+private:
+    /// Which source database, and which of its sequences, this database has caught up with.
+    struct State {
+        string                  source;
+        map<string, uint64_t>   through;
+    };
+
+    static constexpr slice kStateStore = "cblite", kStateKey = "restore";
+
+
+    State readState() {
+        State state;
+        C4Error error;
+        C4RawDocument *raw = c4raw_get(_db, kStateStore, kStateKey, &error);
+        if (raw) {
+            Doc doc = Doc::fromJSON(raw->body, nullptr);
+            c4raw_free(raw);
+            state.source = string(doc["source"].asString());
+            for (Dict::iterator i(doc["through"].asDict()); i; ++i)
+                state.through[string(i.keyString())] = i.value().asUnsigned();
+        } else {
+            // No deltas applied yet, so this is an untouched full backup, with the same UUID and
+            // sequences as the database it was made from:
+            state.source = publicUUIDString(_db);
+            for (auto &spec : allCollections()) {
+                C4Collection *coll = _db->getCollection(spec);
+                state.through[string(spec.keyspace())] = uint64_t(c4coll_getLastSequence(coll));
+            }
+        }
+        return state;
+    }
+
+
+    void saveState(const State &state) {
+        JSONEncoder enc;
+        enc.beginDict();
+        enc.writeKey("source");
+        enc.writeString(state.source);
+        enc.writeKey("through");
+        enc.beginDict();
+        for (auto &[name, seq] : state.through) {
+            enc.writeKey(name);
+            enc.writeUInt(seq);
+        }
+        enc.endDict();
+        enc.endDict();
+        C4Error error;
+        if (!c4raw_put(_db, kStateStore, kStateKey, nullslice, enc.finish(), &error))
+            fail("saving restore state", error);
+    }
+
+
+    void applyDelta(const string &path, State &state) {
+        DeltaHeader header = DeltaHeader::read(path);
+        if (header.sourceUUID != state.source)
+            fail(path + " was made from a different database");
+        for (auto &[name, range] : header.collections) {
+            uint64_t current = state.through[name];
+            if (range.since != current)
+                fail(stringprintf("%s starts after sequence %llu of %s, but this database is at "
+                                  "%llu; deltas must be applied in the order they were made",
+                                  path.c_str(), (unsigned long long)range.since, name.c_str(),
+                                  (unsigned long long)current));
+        }
+
+        Stopwatch st;
+        ifstream in(path, ios::binary);
+        string line;
+        getline(in, line);      // skip header
+
+        C4BlobStore *blobStore = c4db_getBlobStore(_db, nullptr);
+        map<string, C4Collection*> collections;
+        uint64_t nDocs = 0, nBlobs = 0;
+        unsigned transactionSize = 0;
+        C4Error error;
+        auto t = make_unique<c4::Transaction>(_db);
+        if (!t->begin(&error))
+            fail("starting transaction", error);
+
+        while (getline(in, line)) {
+            Doc doc = Doc::fromJSON(line, nullptr);
+            Dict item = doc.asDict();
+            if (!item)
+                fail("Invalid line in " + path);
+
+            if (slice digest = item["blob"].asString(); digest) {
+                C4BlobKey key;
+                if (!c4blob_keyFromString(digest, &key))
+                    fail("Invalid blob digest in " + path);
+                if (c4blob_getSize(blobStore, key) < 0) {
+                    alloc_slice data = base64::decode(item["data"].asString());
+                    if (c4blob_create(blobStore, data, &key, nullptr, &error))
+                        ++nBlobs;
+                    else
+                        errorOccurred("restoring blob " + string(digest), error);
+                }
+                continue;
+            }
+
+            string collName(item["collection"].asString());
+            C4Collection* &coll = collections[collName];
+            if (!coll) {
+                coll = c4db_createCollection(_db, CollectionName(collName), &error);
+                if (!coll)
+                    fail("Couldn't create collection " + collName, error);
+            }
+
+            Dict body = item["body"].asDict();
+            SharedEncoder enc(c4db_getSharedFleeceEncoder(_db));
+            enc.writeValue(body);
+            alloc_slice encodedBody = enc.finish();
+
+            vector<C4String> history;
+            for (Array::iterator i(item["history"].asArray()); i; ++i)
+                history.push_back(i.value().asString());
+
+            C4DocPutRequest put = {};
+            put.docID = item["id"].asString();
+            put.body = encodedBody;
+            put.existingRevision = true;
+            put.history = history.data();
+            put.historyCount = history.size();
+            if (item["deleted"].asBool())
+                put.revFlags |= kRevDeleted;
+            if (c4doc_dictContainsBlobs(body))
+                put.revFlags |= kRevHasAttachments;
+            put.save = true;
+
+            c4::ref<C4Document> saved = c4coll_putDoc(coll, &put, nullptr, &error);
+            if (saved) {
+                ++nDocs;
+                if (auto exp = item["expiration"].asInt(); exp > 0)
+                    (void)c4coll_setDocExpiration(coll, put.docID, C4Timestamp(exp), nullptr);
+            } else {
+                errorOccurred("restoring document \"" + string(slice(put.docID)) + "\"", error);
+            }
+
+            if (++transactionSize >= kMaxTransactionSize) {
+                if (!t->commit(&error))
+                    fail("committing transaction", error);
+                t = make_unique<c4::Transaction>(_db);
+                if (!t->begin(&error))
+                    fail("starting transaction", error);
+                transactionSize = 0;
+            }
+        }
+
+        // Record the new state in the same transaction as the last documents:
+        for (auto &[name, range] : header.collections)
+            state.through[name] = range.through;
+        saveState(state);
+        if (!t->commit(&error))
+            fail("committing transaction", error);
+
+        cout << "Applied " << path << ": " << nDocs << " docs and " << nBlobs << " blobs in "
+             << st.elapsed() << " secs\n";
+        if (_errorCount > 0)
+            cerr << "** " << _errorCount << " errors occurred; see above **\n";
+    }
+
+
+    static constexpr unsigned kMaxTransactionSize = 100000;
+};
+
+
+CBLiteCommand* newRestoreCommand(CBLiteTool &parent) {
+    return new RestoreCommand(parent);
+}
@@ -62,6 +62,7 @@ public:
         ok = c4coll_deleteIndex(collection(), slice(name), &error);
         if (!ok)
             fail("Couldn't delete index", error);
+        invalidateQueryCache();
 
         cout << "Deleted index '" << name << "'.\n";
     }
@@ -51,8 +51,10 @@ public:
         if (!fleeceResult)
             fail("Query failed", error);
 
-        prettyPrint(ValueFromData(fleeceResult), cout);
-        cout << '\n';
+        OutputSink &out = OutputSink::console();
+        prettyPrint(ValueFromData(fleeceResult), out);
+        out << '\n';
+        out.flush();
     }
 
 };
@@ -0,0 +1,96 @@
+//
+// TableWriter.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "TableWriter.hh"
+#include <algorithm>
+
+using namespace std;
+
+
+TableWriter::TableWriter(vector<string> titles, OutputSink &out, size_t bufferLimit)
+:_titles(std::move(titles))
+,_out(out)
+,_bufferLimit(bufferLimit)
+{
+    for (auto &title : _titles)
+        _widths.push_back(title.size());  // not UTF-8-aware...
+}
+
+
+void TableWriter::addRow(Row row) {
+    ++_rowCount;
+    if (_streaming) {
+        writeRow(row);
+        return;
+    }
+    for (size_t col = 0; col < row.size(); ++col) {
+        _widths[col] = max(_widths[col], row[col].text.size());
+        _bufferSize += row[col].text.size();
+    }
+    _buffer.push_back(std::move(row));
+    if (_bufferSize >= _bufferLimit)
+        startStreaming();
+}
+
+
+void TableWriter::finish() {
+    if (_rowCount == 0)
+        _out << "(No results)\n";
+    else if (!_streaming)
+        startStreaming();
+    _out.flush();
+}
+
+
+// Writes the titles and the buffered rows; from now on rows are written as they're added.
+void TableWriter::startStreaming() {
+    _streaming = true;
+    auto nCols = _titles.size();
+    if (nCols > 1) {
+        _out << _out.bold();
+        for (size_t col = 0; col < nCols; ++col)
+            writeCell(_titles[col], col, false);
+        _out << "\n";
+        for (size_t col = 0; col < nCols; ++col)
+            _out << string(_widths[col], '_') << ' ';
+        _out << _out.reset() << '\n';
+    }
+    for (auto &row : _buffer)
+        writeRow(row);
+    _buffer.clear();
+    _buffer.shrink_to_fit();
+    _bufferSize = 0;
+}
+
+
+void TableWriter::writeRow(const Row &row) {
+    for (size_t col = 0; col < row.size(); ++col)
+        writeCell(row[col].text, col, row[col].alignRight);
+    _out << '\n';
+}
+
+
+void TableWriter::writeCell(const string &s, size_t col, bool alignRight) {
+    bool last = (col == _titles.size() - 1);
+    if (last && !alignRight)
+        _out << s;
+    else
+        _out.writePadded(s, _widths[col], alignRight);
+    if (!last)
+        _out << ' ';
+}
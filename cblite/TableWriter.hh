@@ -0,0 +1,66 @@
+//
+// TableWriter.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "OutputSink.hh"
+#include <string>
+#include <vector>
+
+
+/** Writes rows as a table with aligned columns, in a single pass over the rows.
+    Rows are buffered until the buffer reaches a size limit, so that the column widths fit
+    every row; after that the table is written, and later rows are written immediately using the
+    widths computed so far (a wider value just pushes the rest of its row to the right.) */
+class TableWriter {
+public:
+    struct Cell {
+        std::string text;
+        bool        alignRight = false;     // e.g. for numbers
+    };
+    using Row = std::vector<Cell>;
+
+    static constexpr size_t kDefaultBufferLimit = 16 << 20;
+
+    /// If there's only one column, the title row is omitted.
+    explicit TableWriter(std::vector<std::string> titles,
+                         OutputSink &out = OutputSink::console(),
+                         size_t bufferLimit = kDefaultBufferLimit);
+
+    /// Adds a row. It must have the same number of cells as there are titles.
+    void addRow(Row row);
+
+    /// Writes any buffered rows, then flushes the output.
+    /// Writes "(No results)" if there were no rows at all.
+    void finish();
+
+    uint64_t rowCount() const                   {return _rowCount;}
+
+private:
+    void startStreaming();
+    void writeRow(const Row&);
+    void writeCell(const std::string&, size_t col, bool alignRight);
+
+    std::vector<std::string>    _titles;
+    OutputSink&                 _out;
+    size_t const                _bufferLimit;
+    std::vector<size_t>         _widths;
+    std::vector<Row>            _buffer;
+    size_t                      _bufferSize = 0;
+    uint64_t                    _rowCount = 0;
+    bool                        _streaming = false;
+};
@@ -0,0 +1,321 @@
+//
+// BulkCopier.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "BulkCopier.hh"
+#include "Parallel.hh"
+#include "Stopwatch.hh"
+
+using namespace std;
+using namespace fleece;
+using namespace litecore;
+
+
+/// A slice of a source collection's sequence range, read by one reader.
+struct BulkCopier::Task {
+    size_t      collectionIndex;
+    uint64_t    since, through;             // Copies the docs with sequences in (since, through]
+};
+
+
+/// A document read from the source, independent of the source database.
+struct BulkCopier::Doc {
+    size_t              collectionIndex;
+    alloc_slice         docID;
+    vector<alloc_slice> history;            // Current revID first (or the version vector)
+    C4RevisionFlags     revFlags;
+    alloc_slice         body;               // Fleece, encoded without shared keys
+    C4Timestamp         expiration;
+};
+
+
+static void fail(const string &message, C4Error err = {}) {
+    LiteCoreTool::instance()->fail(message, err);
+}
+
+
+BulkCopier::BulkCopier(C4Database *src, C4Database *dst)
+:_src(c4db_retain(src))
+,_dst(c4db_retain(dst))
+,_readerThreads(defaultParallelism())
+{
+    _versionVectors = (c4db_getConfig2(src)->flags & kC4DB_VersionVectors) != 0;
+    if (_versionVectors != ((c4db_getConfig2(dst)->flags & kC4DB_VersionVectors) != 0))
+        fail("Can't copy documents between a database with version vectors and one without");
+}
+
+
+void BulkCopier::addCollection(const CollectionName &src, const CollectionName &dst) {
+    C4Error err;
+    if (!c4db_getCollection(_src, src, &err))
+        fail("Source database has no collection " + string(src.keyspace()));
+    C4Collection *target = c4db_createCollection(_dst, dst, &err);
+    if (!target)
+        fail("Couldn't create collection " + string(dst.keyspace()), err);
+    _counts.push_back({src, dst});
+    _targets.push_back(target);
+}
+
+
+uint64_t BulkCopier::totalDocs() const {
+    uint64_t total = 0;
+    for (auto &c : _counts)
+        total += c.docs;
+    return total;
+}
+
+
+void BulkCopier::run() {
+    // Split each collection's sequence range into about one slice per reader:
+    vector<Task> tasks;
+    for (size_t c = 0; c < _counts.size(); ++c) {
+        C4Collection *coll = c4db_getCollection(_src, _counts[c].source, nullptr);
+        uint64_t last = uint64_t(c4coll_getLastSequence(coll));
+        uint64_t step = std::max(last / _readerThreads + 1, uint64_t(kBatchSize));
+        for (uint64_t since = 0; since < last; since += step)
+            tasks.push_back({c, since, std::min(since + step, last)});
+    }
+
+    BoundedQueue<Batch> queue(4 * _readerThreads);
+    exception_ptr readError;
+    thread readers([&] {
+        try {
+            parallelFor(tasks.size(), _readerThreads, [&](size_t i) {
+                // Database connections aren't thread-safe, so each reader needs its own:
+                C4Error err;
+                c4::ref<C4Database> db = openReadOnlyConnection(_src, &err);
+                if (!db)
+                    fail("Couldn't open another connection to the source database", err);
+                readTask(db, tasks[i], [&](Batch &&batch) {return queue.push(std::move(batch));});
+            });
+        } catch (...) {
+            readError = current_exception();
+        }
+        queue.close();
+    });
+
+    auto verbose = Tool::instance->verbose();
+    Stopwatch st;
+    try {
+        uint64_t nDocs = 0;
+        while (auto batch = queue.pop()) {
+            for (Doc &doc : *batch)
+                writeDoc(doc);
+            nDocs += batch->size();
+            if (verbose) {
+                cout << "\rCopied " << nDocs << " documents (" << int(nDocs / st.elapsed()) << "/sec)";
+                cout.flush();
+            }
+        }
+        commit();
+        if (verbose)
+            cout << "\n";
+    } catch (...) {
+        queue.close();          // makes the readers stop
+        readers.join();
+        if (_inTransaction)
+            (void)c4db_endTransaction(_dst, false, nullptr);
+        _inTransaction = false;
+        throw;
+    }
+    readers.join();
+    if (readError)
+        rethrow_exception(readError);
+}
+
+
+// Runs on a reader thread, using its own connection `db`.
+void BulkCopier::readTask(C4Database *db, const Task &task, const function<bool(Batch&&)> &emit) {
+    C4Error err;
+    auto &spec = _counts[task.collectionIndex].source;
+    C4Collection *coll = c4db_getCollection(db, spec, &err);
+    if (!coll)
+        fail("Couldn't open collection " + string(spec.keyspace()), err);
+    // Include bodies, so each doc comes with its body and revision history without another
+    // lookup:
+    C4EnumeratorOptions options = {kC4IncludeNonConflicted | kC4IncludeDeleted | kC4IncludeBodies};
+    c4::ref<C4DocEnumerator> e = c4coll_enumerateChanges(coll, C4SequenceNumber(task.since),
+                                                         &options, &err);
+    if (!e)
+        fail("enumerating source documents", err);
+
+    Batch batch;
+    Encoder enc;        // no shared keys, so the writer can re-encode bodies for the target's
+    while (c4enum_next(e, &err)) {
+        C4DocumentInfo info;
+        c4enum_getDocumentInfo(e, &info);
+        if (uint64_t(info.sequence) > task.through)
+            break;
+        c4::ref<C4Document> c4doc = c4enum_getDocument(e, &err);
+        if (!c4doc)
+            fail("reading document \"" + string(slice(info.docID)) + "\"", err);
+
+        Doc &doc = batch.emplace_back();
+        doc.collectionIndex = task.collectionIndex;
+        doc.docID = info.docID;
+        doc.revFlags = c4doc->selectedRev.flags & (kRevDeleted | kRevHasAttachments);
+        doc.expiration = info.expiration;
+
+        Dict body = c4doc_getProperties(c4doc);
+        if (body) {
+            enc.writeValue(body);
+        } else {
+            enc.beginDict();
+            enc.endDict();
+        }
+        doc.body = enc.finish();
+        enc.reset();
+
+        doc.history = currentRevisionHistory(c4doc, _versionVectors);
+
+        if (batch.size() >= kBatchSize) {
+            if (!emit(std::move(batch)))
+                return;             // writer has stopped
+            batch = Batch();
+        }
+    }
+    if (err.code)
+        fail("enumerating source documents", err);
+    if (!batch.empty())
+        emit(std::move(batch));
+}
+
+
+void BulkCopier::writeDoc(Doc &doc) {
+    enterTransaction();
+    C4Collection *target = _targets[doc.collectionIndex];
+
+    // Re-encode the body using the target database's shared keys:
+    Dict body = ValueFromData(doc.body).asDict();
+    if (doc.revFlags & kRevHasAttachments)
+        copyBlobs(body);
+    SharedEncoder enc(c4db_getSharedFleeceEncoder(_dst));
+    enc.writeValue(body);
+    alloc_slice encoded = enc.finish();
+
+    vector<C4String> history(doc.history.begin(), doc.history.end());
+    C4DocPutRequest put = {};
+    put.docID = doc.docID;
+    put.body = encoded;
+    put.existingRevision = true;
+    put.history = history.data();
+    put.historyCount = history.size();
+    put.revFlags = doc.revFlags;
+    put.save = true;
+
+    // If the target already has this revision, the put succeeds without saving anything, so
+    // the doc keeps a sequence from before:
+    C4Error err;
+    C4SequenceNumber lastSequence = c4coll_getLastSequence(target);
+    c4::ref<C4Document> saved = c4coll_putDoc(target, &put, nullptr, &err);
+    if (saved && saved->sequence <= lastSequence) {
+        ++_counts[doc.collectionIndex].unchanged;
+    } else if (saved) {
+        ++_counts[doc.collectionIndex].docs;
+        if (doc.expiration)
+            (void)c4coll_setDocExpiration(target, doc.docID, doc.expiration, nullptr);
+    } else if (err.domain == LiteCoreDomain && err.code == kC4ErrorConflict) {
+        ++_counts[doc.collectionIndex].conflicts;
+    } else {
+        LiteCoreTool::instance()->errorOccurred("copying document \"" + string(doc.docID) + "\"",
+                                                err);
+    }
+
+    if (++_transactionSize >= kMaxTransactionSize)
+        commit();
+}
+
+
+vector<alloc_slice> BulkCopier::currentRevisionHistory(C4Document *doc, bool versionVectors) {
+    vector<alloc_slice> history;
+    c4doc_selectCurrentRevision(doc);
+    if (versionVectors) {
+        history.emplace_back(c4doc_getRevisionHistory(doc, 0, nullptr, 0));
+    } else {
+        do {
+            history.emplace_back(doc->selectedRev.revID);
+        } while (c4doc_selectParentRevision(doc));
+        c4doc_selectCurrentRevision(doc);
+    }
+    return history;
+}
+
+
+void BulkCopier::forEachBlob(Dict body, function_ref<void(const C4BlobKey&)> callback) {
+    FLDeepIterator i = FLDeepIterator_New(body);
+    for (; FLDeepIterator_GetValue(i); FLDeepIterator_Next(i)) {
+        C4BlobKey key;
+        FLDict dict = FLValue_AsDict(FLDeepIterator_GetValue(i));
+        if (dict && c4doc_getDictBlobKey(dict, &key)) {
+            FLDeepIterator_SkipChildren(i);
+            callback(key);
+        }
+    }
+    FLDeepIterator_Free(i);
+}
+
+
+// Copies every blob referenced by `body` that the target doesn't already have.
+void BulkCopier::copyBlobs(Dict body) {
+    C4BlobStore *srcStore = c4db_getBlobStore(_src, nullptr);
+    C4BlobStore *dstStore = c4db_getBlobStore(_dst, nullptr);
+    forEachBlob(body, [&](C4BlobKey key) {
+        if (c4blob_getSize(dstStore, key) >= 0)
+            return;
+
+        C4Error err = {};
+        C4ReadStream *in = c4blob_openReadStream(srcStore, key, &err);
+        C4WriteStream *out = in ? c4blob_openWriteStream(dstStore, &err) : nullptr;
+        if (out) {
+            char buf[65536];
+            size_t n;
+            while ((n = c4stream_read(in, buf, sizeof(buf), &err)) > 0) {
+                if (!c4stream_write(out, buf, n, &err))
+                    break;
+            }
+            if (err.code == 0 && c4stream_install(out, &key, &err))
+                ++_blobsCopied;
+        }
+        c4stream_closeWriter(out);
+        c4stream_close(in);
+        if (err.code) {
+            alloc_slice keyStr(c4blob_keyToString(key));
+            LiteCoreTool::instance()->errorOccurred("copying blob " + string(keyStr), err);
+        }
+    });
+}
+
+
+void BulkCopier::enterTransaction() {
+    if (!_inTransaction) {
+        C4Error err;
+        if (!c4db_beginTransaction(_dst, &err))
+            fail("starting transaction", err);
+        _inTransaction = true;
+    }
+}
+
+
+void BulkCopier::commit() {
+    if (_inTransaction) {
+        C4Error err;
+        if (!c4db_endTransaction(_dst, true, &err))
+            fail("committing transaction", err);
+        _inTransaction = false;
+        _transactionSize = 0;
+    }
+}
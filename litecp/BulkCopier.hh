@@ -0,0 +1,93 @@
+//
+// BulkCopier.hh
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "CBLiteTool.hh"
+#include "c4Base.hh"
+#include "fleece/Fleece.hh"
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+
+/** Copies documents, with their revision history, directly from one local database into
+    another, without the replicator. Existing documents in the target are updated if the source
+    revision descends from theirs; otherwise they're left alone and counted as conflicts.
+
+    Reader threads scan slices of the source collections' sequence ranges, each through its own
+    read-only connection, and pass batches of documents to the calling thread, which writes them
+    to the target in large transactions. Only the current revision of each document is copied,
+    along with any blobs it references. */
+class BulkCopier {
+public:
+    BulkCopier(C4Database *src, C4Database *dst);
+
+    /// Adds a source collection to copy, and the target collection to copy it into.
+    /// The target collection is created if it doesn't exist.
+    void addCollection(const CollectionName &src, const CollectionName &dst);
+
+    /// Sets the number of reader threads. Defaults to `defaultParallelism()`.
+    void setReaderThreads(unsigned n)               {_readerThreads = std::max(n, 1u);}
+
+    /// Copies all the collections. Throws on fatal errors; per-document errors are reported
+    /// through the tool's `errorOccurred`.
+    void run();
+
+    struct Counts {
+        CollectionName  source, target;
+        uint64_t        docs {0};           // Docs written
+        uint64_t        conflicts {0};      // Docs skipped because the target's revision conflicts
+        uint64_t        unchanged {0};      // Docs skipped because the target already has them
+    };
+
+    const std::vector<Counts>& counts() const       {return _counts;}
+    uint64_t totalDocs() const;
+    uint64_t blobsCopied() const                    {return _blobsCopied;}
+
+    /// Returns the history of a document's current revision, for use in a `C4DocPutRequest`
+    /// with `existingRevision`: its revID followed by its ancestors' (or just its version
+    /// vector.) The document must have been loaded with `kDocGetAll`.
+    static std::vector<fleece::alloc_slice> currentRevisionHistory(C4Document*,
+                                                                   bool versionVectors);
+
+    /// Calls `callback` with the key of every blob referenced by `body`.
+    static void forEachBlob(fleece::Dict body, fleece::function_ref<void(const C4BlobKey&)>);
+
+private:
+    struct Task;
+    struct Doc;
+    using Batch = std::vector<Doc>;
+
+    void readTask(C4Database *src, const Task&, const std::function<bool(Batch&&)> &emit);
+    void writeDoc(Doc&);
+    void copyBlobs(fleece::Dict body);
+    void enterTransaction();
+    void commit();
+
+    c4::ref<C4Database>     _src, _dst;
+    unsigned                _readerThreads;
+    bool                    _versionVectors;
+    std::vector<Counts>     _counts;
+    std::vector<C4Collection*> _targets;
+    bool                    _inTransaction {false};
+    unsigned                _transactionSize {0};
+    uint64_t                _blobsCopied {0};
+
+    static constexpr unsigned kBatchSize = 1000;
+    static constexpr unsigned kMaxTransactionSize = 100000;
+};
@@ -243,6 +243,7 @@ void DbEndpoint::finish() {
 void DbEndpoint::commit() {
     if (_inTransaction) {
         if (Tool::instance->verbose() > 1) {
+            OutputSink::console().flush();
             cout << "[Committing ... ";
             cout.flush();
         }
@@ -263,6 +264,39 @@ void DbEndpoint::commit() {
 #pragma mark - REPLICATION:
 
 
+std::optional<ReplicatorTuning> ReplicatorTuning::named(std::string_view name) {
+    ReplicatorTuning t;
+    if (name == "default") {
+        // leave everything unset
+    } else if (name == "bulk") {
+        // Initial load into an empty DB: there are no old revisions to diff against, so deltas
+        // only cost CPU; saving checkpoints rarely keeps the insertion transactions big.
+        t.deltas = false;
+        t.checkpointInterval = 60;
+        t.compressionLevel = 1;
+    } else if (name == "lowlatency") {
+        // Continuous sync of small changes: save checkpoints often and detect dead sockets fast.
+        t.deltas = true;
+        t.checkpointInterval = 1;
+        t.heartbeat = 15;
+        t.compressionLevel = 0;
+    } else if (name == "lowbandwidth") {
+        // Slow or metered network: trade CPU for bytes on the wire.
+        t.deltas = true;
+        t.compressionLevel = 9;
+    } else {
+        return nullopt;
+    }
+    return t;
+}
+
+
+const std::vector<std::string_view>& ReplicatorTuning::profileNames() {
+    static const vector<string_view> kNames = {"default", "bulk", "lowlatency", "lowbandwidth"};
+    return kNames;
+}
+
+
 static const char* nameOfMode(C4ReplicatorMode push, C4ReplicatorMode pull) {
     if (push >= kC4OneShot && pull >= kC4OneShot)
         return "Pushing/pulling with";
@@ -278,11 +312,12 @@ void DbEndpoint::startReplicationWith(RemoteEndpoint &remote, bool pushing) {
     auto pullMode = (_bidirectional ? pushMode : kC4Disabled);
     if (!pushing)
         swap(pushMode, pullMode);
-    if (Tool::instance->verbose())
+    if (Tool::instance->verbose()) {
         cout << nameOfMode(pushMode, pullMode) << " remote database";
-    if (_continuous)
-        cout << ", continuously";
-    cout << "...\n";
+        if (_continuous)
+            cout << ", continuously";
+        cout << "...\n";
+    }
     C4ReplicatorParameters params = replicatorParameters(pushMode, pullMode);
 
     // This must be done here to avoid this vector going out of scope
@@ -304,21 +339,35 @@ void DbEndpoint::replicateWith(RemoteEndpoint &remote, bool pushing) {
 
 
 void DbEndpoint::pushToLocal(DbEndpoint &dst) {
+    // Per-collection counts need a callback for every doc, so they're only kept with --parallel:
+    _countPerCollection = (_parallelism > 1 && _collectionSpecs.size() > 1);
+    if (_countPerCollection) {
+        pushToLocalInParallel(dst);
+    } else {
+        startPushToLocal(dst);
+        finishReplication();
+    }
+    if (_countPerCollection)
+        writeCollectionCounts();
+}
+
+
+void DbEndpoint::startPushToLocal(DbEndpoint &dst) {
 #ifdef COUCHBASE_ENTERPRISE
     auto pushMode = (_continuous ? kC4Continuous : kC4OneShot);
     auto pullMode = (_bidirectional ? pushMode : kC4Disabled);
-    if (Tool::instance->verbose())
-        cout << nameOfMode(kC4OneShot, pullMode)  << " local database";
-    if (_continuous)
-        cout << ", continuously";
-    cout << "...\n";
-    C4ReplicatorParameters params = replicatorParameters(kC4OneShot, pullMode);
+    if (Tool::instance->verbose()) {
+        cout << nameOfMode(pushMode, pullMode)  << " local database";
+        if (_continuous)
+            cout << ", continuously";
+        cout << "...\n";
+    }
+    C4ReplicatorParameters params = replicatorParameters(pushMode, pullMode);
 
     // This must be done here to avoid this vector going out of scope
     std::vector<C4ReplicationCollection> replicationCollections;
-    for (size_t index = 0; index < _collectionSpecs.size(); ++index) {
-        replicationCollections.push_back({ _collectionSpecs[index++], pushMode, pullMode });
-    }
+    for (auto& coll : _collectionSpecs)
+        replicationCollections.push_back({coll, pushMode, pullMode});
 
     params.collectionCount = replicationCollections.size();
     params.collections = replicationCollections.data();
@@ -331,6 +380,143 @@ void DbEndpoint::pushToLocal(DbEndpoint &dst) {
 }
 
 
+void DbEndpoint::pushToLocalInParallel(DbEndpoint &dst) {
+#ifdef COUCHBASE_ENTERPRISE
+    auto pushMode = (_continuous ? kC4Continuous : kC4OneShot);
+    auto pullMode = (_bidirectional ? pushMode : kC4Disabled);
+    size_t n = std::min(size_t(_parallelism), _collectionSpecs.size());
+    if (Tool::instance->verbose()) {
+        cout << nameOfMode(pushMode, pullMode) << " local database with " << n << " replicators";
+        if (_continuous)
+            cout << ", continuously";
+        cout << "...\n";
+    }
+
+    // Deal the collections out to the replicators round-robin:
+    _localReplicators.clear();
+    for (size_t i = 0; i < n; ++i)
+        _localReplicators.emplace_back(new LocalReplicator{this});
+    for (size_t i = 0; i < _collectionSpecs.size(); ++i)
+        _localReplicators[i % n]->collections.push_back({_collectionSpecs[i], pushMode, pullMode});
+
+    // Waits for the callbacks to report every started replicator stopped. (Polling
+    // `c4repl_getStatus` isn't enough: LiteCore sets the stopped status before it calls
+    // `onStatusChanged`, so a callback could still be using its LocalReplicator.)
+    // Then releases the replicators and frees their contexts.
+    auto waitForAll = [&] {
+        vector<C4Error> errors;
+        {
+            unique_lock<mutex> lock(_mutex);
+            _allStopped.wait(lock, [&] {
+                return std::all_of(_localReplicators.begin(), _localReplicators.end(),
+                                   [](auto &r) {return !r->replicator || r->stopped;});
+            });
+            for (auto &r : _localReplicators) {
+                if (r->error.code)
+                    errors.push_back(r->error);
+            }
+        }
+        for (auto &r : _localReplicators)
+            r->replicator = nullptr;
+        {
+            lock_guard<mutex> lock(_mutex);
+            _localReplicators.clear();
+        }
+        startLine();
+        return errors;
+    };
+
+    _stopwatch.start();
+    for (auto &r : _localReplicators) {
+        // Each replicator gets its own callback context, so progress can be tracked per replicator:
+        C4ReplicatorParameters params = replicatorParameters(pushMode, pullMode);
+        params.collectionCount = r->collections.size();
+        params.collections = r->collections.data();
+        params.callbackContext = r.get();
+        params.onStatusChanged = [](C4Replicator*, C4ReplicatorStatus status, void *context) {
+            auto r = (LocalReplicator*)context;
+            r->owner->onLocalStateChanged(*r, status);
+        };
+        params.onDocumentsEnded = [](C4Replicator*,
+                                     bool pushing,
+                                     size_t count,
+                                     const C4DocumentEnded* docs[],
+                                     void *context)
+        {
+            ((LocalReplicator*)context)->owner->onDocsEnded(pushing, count, docs);
+        };
+
+        C4Error err;
+        r->replicator = c4repl_newLocal(_db, dst._db, params, C4STR("cblite_cli"), &err);
+        if (!r->replicator) {
+            // Stop the ones already running before giving up:
+            for (auto &other : _localReplicators) {
+                if (other->replicator)
+                    c4repl_stop(other->replicator);
+            }
+            waitForAll();
+            errorOccurred("starting replication", err);
+            fail();
+        }
+        c4repl_start(r->replicator, false);
+    }
+
+    auto errors = waitForAll();
+    for (auto &err : errors)
+        errorOccurred("replicating", err);
+    if (!errors.empty())
+        fail();
+#else
+    error::_throw(error::Domain::LiteCore, kC4ErrorUnimplemented);
+#endif
+}
+
+
+void DbEndpoint::onLocalStateChanged(LocalReplicator &repl, C4ReplicatorStatus status) {
+    lock_guard<mutex> lock(_mutex);
+    repl.docCount = status.progress.documentCount;
+    repl.stopped = (status.level == kC4Stopped);
+    if (repl.stopped)
+        repl.error = status.error;
+
+    uint64_t documentCount = 0;
+    size_t nStopped = 0;
+    for (auto &r : _localReplicators) {
+        documentCount += r->docCount;
+        nStopped += r->stopped;
+    }
+
+    if (LiteCoreTool::instance()->verbose()) {
+        auto elapsed = _stopwatch.elapsed();
+        int rate = (elapsed > 0) ? int(documentCount / elapsed) : 0;
+        cout << "\r" << nStopped << " of " << _localReplicators.size() << " replicators done ... "
+             << documentCount << " documents (" << rate << "/sec)";
+        _needNewline = true;
+        cout.flush();
+    }
+
+    if (status.error.code != 0) {
+        startLine();
+        char message[200];
+        c4error_getDescriptionC(status.error, message, sizeof(message));
+        C4Log("** Replicator error: %s", message);
+    }
+
+    setDocCount(documentCount);
+    _otherEndpoint->setDocCount(documentCount);
+
+    if (repl.stopped)
+        _allStopped.notify_all();       // `waitForAll` checks whether they all have
+}
+
+
+void DbEndpoint::writeCollectionCounts() {
+    lock_guard<mutex> lock(_mutex);
+    for (auto &spec : _collectionSpecs)
+        cout << "    " << spec.keyspace() << ": " << _docsPerCollection[spec] << " docs\n";
+}
+
+
 void DbEndpoint::startReplicator(C4Replicator *repl, C4Error &err) {
     if (!repl) {
         errorOccurred("starting replication", err);
@@ -362,12 +548,31 @@ void DbEndpoint::stopReplication() {
 }
 
 
+C4ReplicatorStatus DbEndpoint::replicateFor(double seconds, double &outElapsed) {
+    assert(_replicator);
+    bool stopping = false;
+    C4ReplicatorStatus status;
+    while ((status = c4repl_getStatus(_replicator)).level != kC4Stopped) {
+        if (!stopping && _stopwatch.elapsed() >= seconds) {
+            c4repl_stop(_replicator);
+            stopping = true;
+        }
+        this_thread::sleep_for(chrono::milliseconds(100));
+    }
+    outElapsed = _stopwatch.elapsed();
+    _replicator = nullptr;
+    startLine();
+    return status;
+}
+
+
 void DbEndpoint::finishReplication() {
     assert(_replicator);
     C4ReplicatorStatus status;
     while ((status = c4repl_getStatus(_replicator)).level != kC4Stopped)
         this_thread::sleep_for(chrono::milliseconds(100));
     _replicator = nullptr;
+    _replicationError = status.error;
     startLine();
 
     if (status.error.code) {
@@ -385,9 +590,19 @@ C4ReplicatorParameters DbEndpoint::replicatorParameters(C4ReplicatorMode push, C
         fleece::Encoder enc;
         enc.beginDict();
 
-        //enc[slice(kC4ReplicatorOptionProgressLevel)] = 1;   // callback on every doc
+        if (_countPerCollection)
+            enc[slice(kC4ReplicatorOptionProgressLevel)] = 1;   // callback on every doc
         enc[slice(kC4ReplicatorOptionMaxRetries)] = _maxRetries;
 
+        if (_tuning.deltas)
+            enc[slice(kC4ReplicatorOptionDisableDeltas)] = !*_tuning.deltas;
+        if (_tuning.checkpointInterval)
+            enc[slice(kC4ReplicatorCheckpointInterval)] = *_tuning.checkpointInterval;
+        if (_tuning.heartbeat)
+            enc[slice(kC4ReplicatorHeartbeatInterval)] = *_tuning.heartbeat;
+        if (_tuning.compressionLevel)
+            enc[slice(kC4ReplicatorCompressionLevel)] = *_tuning.compressionLevel;
+
         if (!_credentials.first.empty() || _clientCert) {
             enc.writeKey(slice(kC4ReplicatorOptionAuthentication));
             enc.beginDict();
@@ -503,6 +718,10 @@ void DbEndpoint::onDocsEnded(bool pushing,
         auto doc = docs[i];
         if (doc->error.code == 0) {
            // _otherEndpoint->logDocument(docID);
+            if (_countPerCollection) {
+                lock_guard<mutex> lock(_mutex);
+                ++_docsPerCollection[CollectionName(doc->collectionSpec)];
+            }
         } else {
             startLine();
             char message[200];
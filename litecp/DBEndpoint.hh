@@ -21,11 +21,35 @@
 #include "c4Replicator.h"
 #include "Stopwatch.hh"
 #include "fleece/slice.hh"
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
 
 class JSONEndpoint;
 class RemoteEndpoint;
 
 
+/** Replicator settings that affect throughput, set as a group by a named profile.
+    Unset values leave the replicator's own default in place. */
+struct ReplicatorTuning {
+    std::optional<bool>     deltas;                 // Use delta sync?
+    std::optional<unsigned> checkpointInterval;     // Seconds between checkpoint saves
+    std::optional<unsigned> heartbeat;              // Seconds between WebSocket pings
+    std::optional<int>      compressionLevel;       // zlib level of BLIP messages (0-9)
+
+    /// Returns the profile with the given name, or nullopt if there is none.
+    static std::optional<ReplicatorTuning> named(std::string_view name);
+
+    /// The names of all profiles, in the order `--calibrate` tries them.
+    static const std::vector<std::string_view>& profileNames();
+};
+
+
+
 class DbEndpoint : public Endpoint {
 public:
     explicit DbEndpoint(const std::string &spec, std::vector<CollectionName>);
@@ -34,11 +58,14 @@ public:
 
     virtual bool isDatabase() const override        {return true;}
     fleece::alloc_slice path() const;
+    C4Database* database() const                    {return _db;}
 
     virtual void prepare(bool isSource, const Options& options, const Endpoint*) override;
     void setBidirectional(bool bidi)                {_bidirectional = bidi;}
     void setContinuous(bool cont)                   {_continuous = cont;}
     void setMaxRetries(unsigned n)                  {_maxRetries = n;}
+    void setParallelism(unsigned n)                 {_parallelism = std::max(n, 1u);}
+    void setTuning(const ReplicatorTuning &t)       {_tuning = t;}
     void setCollections(std::vector<CollectionName>);
 
     using credentials = std::pair<std::string, std::string>;
@@ -53,7 +80,11 @@ public:
     virtual void writeJSON(fleece::slice docID, fleece::slice json) override;
     virtual void finish() override;
 
+    /// Replicates to a local database and waits for it to finish. The collections are split
+    /// among up to `parallelism` replicators running concurrently.
     void pushToLocal(DbEndpoint&);
+    /// Starts a single replicator to a local database and returns immediately.
+    void startPushToLocal(DbEndpoint&);
     void replicateWith(RemoteEndpoint&, bool pushing =true);
 
     void startReplicationWith(RemoteEndpoint&, bool pushing);
@@ -61,6 +92,13 @@ public:
     void stopReplication();
     void finishReplication();
 
+    /// The error that the last replication finished with, if any.
+    C4Error replicationError() const                {return _replicationError;}
+
+    /// Lets the running replicator go for up to `seconds`, then stops it if necessary.
+    /// Returns its final status, and the elapsed time in `outElapsed`.
+    C4ReplicatorStatus replicateFor(double seconds, double &outElapsed);
+
     void exportTo(JSONEndpoint*);
     void importFrom(JSONEndpoint*);
 
@@ -70,6 +108,16 @@ public:
                     const C4DocumentEnded* docs[]);
 
 private:
+    /// One of the concurrent replicators started by `pushToLocalInParallel`.
+    struct LocalReplicator {
+        DbEndpoint*                             owner;
+        std::vector<C4ReplicationCollection>    collections;
+        c4::ref<C4Replicator>                   replicator;
+        uint64_t                                docCount {0};   // guarded by owner->_mutex
+        bool                                    stopped {false};
+        C4Error                                 error {};
+    };
+
     C4Collection* getCollection();
     void enterTransaction();
     void commit();
@@ -78,6 +126,9 @@ private:
     void exportTo(Endpoint *dst, uint64_t limit);
     C4ReplicatorParameters replicatorParameters(C4ReplicatorMode push, C4ReplicatorMode pull);
     void startReplicator(C4Replicator*, C4Error&);
+    void pushToLocalInParallel(DbEndpoint&);
+    void onLocalStateChanged(LocalReplicator&, C4ReplicatorStatus);
+    void writeCollectionCounts();
 
     c4::ref<C4Database> _db;
     c4::ref<C4Collection> _collection;
@@ -94,6 +145,7 @@ private:
     bool _bidirectional {false};
     bool _continuous {false};
     unsigned _maxRetries = 0;       // no retries by default
+    ReplicatorTuning _tuning;
     credentials _credentials;
     std::string _sessionToken;
     fleece::alloc_slice _rootCerts;
@@ -101,6 +153,15 @@ private:
     fleece::alloc_slice _options;
     std::vector<CollectionName> _collectionSpecs;
     c4::ref<C4Replicator> _replicator;
+    C4Error _replicationError {};
+
+    // Local replication only:
+    unsigned _parallelism {1};
+    bool _countPerCollection {false};
+    std::vector<std::unique_ptr<LocalReplicator>> _localReplicators;
+    std::mutex _mutex;                              // guards the members below, and LocalReplicator state
+    std::condition_variable _allStopped;            // notified when a LocalReplicator stops
+    std::map<CollectionName, uint64_t> _docsPerCollection;
 
     static constexpr unsigned kMaxTransactionSize = 100000;
 };
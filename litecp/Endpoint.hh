@@ -18,6 +18,7 @@
 
 #pragma once
 #include "CBLiteTool.hh"
+#include "OutputSink.hh"
 #include <memory>
 
 /** Abstract base class for a source or target of copying/replication. */
@@ -75,22 +76,23 @@ public:
     void logDocument(fleece::slice docID) {
         ++_docCount;
         if (Tool::instance->verbose() >= 2)
-            std::cout << to_string(docID) << std::endl;
+            OutputSink::console() << docID << '\n';
         else if (Tool::instance->verbose() == 1 && (_docCount % 1000) == 0)
-            std::cout << _docCount << std::endl;
+            OutputSink::console() << _docCount << '\n';
     }
 
     void logDocuments(unsigned n) {
         _docCount += n;
         if (Tool::instance->verbose() >= 2)
-            std::cout << n << " more documents" << std::endl;
+            OutputSink::console() << n << " more documents\n";
         else if (Tool::instance->verbose() == 1 && (_docCount % 1000) < n)
-            std::cout << _docCount << std::endl;
+            OutputSink::console() << _docCount << '\n';
     }
 
 protected:
     // Forward errors to the tool:
     void errorOccurred(const std::string &what, C4Error err = {}) {
+        OutputSink::console().flush();
         LiteCoreTool::instance()->errorOccurred(what, err);
     }
 
@@ -0,0 +1,108 @@
+//
+// GlobMatcherTest.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "TestsCommon.hh"
+#include "catch.hpp"
+#include "CatchHelper.hh"
+#include "GlobMatcher.hh"
+using namespace std;
+
+TEST_CASE("Glob Matcher", "[cblite][Glob]") {
+    SECTION("Literal") {
+        GlobMatcher g("doc1");
+        CHECK(g.matches("doc1"));
+        CHECK(!g.matches("doc"));
+        CHECK(!g.matches("doc12"));
+        CHECK(!g.matches("Doc1"));
+        CHECK(g.literalPrefix() == "doc1");
+        CHECK(!g.isPrefixOnly());
+    }
+
+    SECTION("Wildcards") {
+        GlobMatcher g("a*b?c");
+        CHECK(g.matches("abxc"));
+        CHECK(g.matches("a123bxc"));
+        CHECK(g.matches("abbbxc"));         // needs backtracking
+        CHECK(!g.matches("abc"));
+        CHECK(!g.matches("a123bxcd"));
+        CHECK(g.literalPrefix() == "a");
+        CHECK(!g.isPrefixOnly());
+
+        GlobMatcher star("*");
+        CHECK(star.matches(""));
+        CHECK(star.matches("anything"));
+        CHECK(star.literalPrefix() == "");
+        CHECK(star.isPrefixOnly());
+
+        GlobMatcher stars("x**");
+        CHECK(stars.matches("x"));
+        CHECK(stars.matches("xyz"));
+        CHECK(stars.isPrefixOnly());
+
+        GlobMatcher empty("");
+        CHECK(empty.matches(""));
+        CHECK(!empty.matches("a"));
+    }
+
+    SECTION("Sets") {
+        GlobMatcher g("user[0-9][!a-c]");
+        CHECK(g.matches("user5d"));
+        CHECK(g.matches("user0Z"));
+        CHECK(!g.matches("userx5"));
+        CHECK(!g.matches("user5b"));
+        CHECK(g.literalPrefix() == "user");
+
+        GlobMatcher bracket("[]x]");
+        CHECK(bracket.matches("]"));
+        CHECK(bracket.matches("x"));
+        CHECK(!bracket.matches("y"));
+
+        GlobMatcher unterminated("a[b");
+        CHECK(unterminated.matches("a[b"));
+        CHECK(unterminated.literalPrefix() == "a[b");
+    }
+
+    SECTION("Escapes") {
+        GlobMatcher g("a\\*b*");
+        CHECK(g.matches("a*b"));
+        CHECK(g.matches("a*bcd"));
+        CHECK(!g.matches("axb"));
+        CHECK(g.literalPrefix() == "a*b");
+        CHECK(g.isPrefixOnly());
+    }
+
+    SECTION("Prefix range") {
+        GlobMatcher g("doc-*");
+        CHECK(g.literalPrefix() == "doc-");
+        CHECK(g.prefixEnd() == "doc.");
+        CHECK(g.isPrefixOnly());
+
+        GlobMatcher none("*x");
+        CHECK(none.prefixEnd() == "");
+        CHECK(!none.isPrefixOnly());
+
+        // Trailing 0xFF bytes can't be incremented, so they're dropped first:
+        GlobMatcher ff("a\xFF*");
+        CHECK(ff.prefixEnd() == "b");
+        GlobMatcher ffff("a\xFF\xFF?");
+        CHECK(ffff.prefixEnd() == "b");
+        CHECK(!ffff.isPrefixOnly());
+        GlobMatcher allFF("\xFF\xFF*");
+        CHECK(allFF.prefixEnd() == "");
+    }
+}
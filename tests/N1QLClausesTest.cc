@@ -0,0 +1,160 @@
+//
+// N1QLClausesTest.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "TestsCommon.hh"
+#include "catch.hpp"
+#include "CatchHelper.hh"
+#include "N1QLClauses.hh"
+using namespace std;
+
+TEST_CASE("N1QL Clauses", "[cblite][N1QL]") {
+    SECTION("All clauses") {
+        auto q = N1QLClauses::parse("SELECT name, count(*) AS n FROM _ WHERE type = 'user' "
+                                    "GROUP BY name HAVING n > 2 ORDER BY name DESC, n "
+                                    "LIMIT 10 OFFSET 5;");
+        REQUIRE(q);
+        CHECK(q->what == "name, count(*) AS n");
+        CHECK(q->from == "_");
+        CHECK(q->where == "type = 'user'");
+        CHECK(q->groupBy == "name");
+        CHECK(q->having == "n > 2");
+        REQUIRE(q->orderBy.size() == 2);
+        CHECK(q->orderBy[0].expression == "name");
+        CHECK(q->orderBy[0].descending);
+        CHECK(q->orderBy[1].expression == "n");
+        CHECK(!q->orderBy[1].descending);
+        CHECK(q->limit == "10");
+        CHECK(q->offset == "5");
+        CHECK(q->toString() == "SELECT name, count(*) AS n FROM _ WHERE type = 'user' "
+                               "GROUP BY name HAVING n > 2 ORDER BY name DESC, n "
+                               "LIMIT 10 OFFSET 5");
+    }
+
+    SECTION("Keywords that aren't clauses") {
+        auto q = N1QLClauses::parse("select * from (select a from b order by a) "
+                                    "where x.order = 'order by' and `where` > 1 order by meta().id");
+        REQUIRE(q);
+        CHECK(q->from == "(select a from b order by a)");
+        CHECK(q->where == "x.order = 'order by' and `where` > 1");
+        REQUIRE(q->orderBy.size() == 1);
+        CHECK(q->orderBy[0].expression == "meta().id");
+    }
+
+    SECTION("Invalid") {
+        CHECK(!N1QLClauses::parse("a FROM b"));
+        CHECK(!N1QLClauses::parse("SELECT a WHERE b FROM c"));
+        CHECK(!N1QLClauses::parse("SELECT a FROM b WHERE c WHERE d"));
+    }
+
+    SECTION("Split conjunction") {
+        auto terms = N1QLClauses::splitConjunction("type = 'a and b' AND (x OR y) AND "
+                                                   "age BETWEEN 18 AND 65 and (n > 1)");
+        REQUIRE(terms.size() == 4);
+        CHECK(terms[0] == "type = 'a and b'");
+        CHECK(terms[1] == "x OR y");
+        CHECK(terms[2] == "age BETWEEN 18 AND 65");
+        CHECK(terms[3] == "n > 1");
+    }
+
+    SECTION("Result expressions") {
+        auto q = N1QLClauses::parse("SELECT DISTINCT user, sum(amount) AS total, "
+                                    "{'as': a.b} as `x`, meta().id FROM _ GROUP BY user");
+        REQUIRE(q);
+        auto exprs = q->resultExpressions();
+        REQUIRE(exprs.size() == 4);
+        CHECK(exprs[0] == "user");
+        CHECK(exprs[1] == "sum(amount)");
+        CHECK(exprs[2] == "{'as': a.b}");
+        CHECK(exprs[3] == "meta().id");
+    }
+
+    SECTION("Order aliases") {
+        auto q = N1QLClauses::parse("SELECT name, count(*) AS n, upper(x) AS `u` FROM _ "
+                                    "GROUP BY name ORDER BY n DESC, `u`, name");
+        REQUIRE(q);
+        auto items = q->resultItems();
+        REQUIRE(items.size() == 3);
+        CHECK(items[0] == make_pair(string("name"), string("")));
+        CHECK(items[1] == make_pair(string("count(*)"), string("n")));
+        CHECK(items[2] == make_pair(string("upper(x)"), string("u")));
+        q->resolveOrderAliases();
+        REQUIRE(q->orderBy.size() == 3);
+        CHECK(q->orderBy[0].expression == "count(*)");
+        CHECK(q->orderBy[0].descending);
+        CHECK(q->orderBy[1].expression == "upper(x)");
+        CHECK(q->orderBy[2].expression == "name");
+    }
+
+    SECTION("ID order") {
+        auto q = N1QLClauses::parse("SELECT * FROM _ ORDER BY lastName");
+        REQUIRE(q);
+        CHECK(q->addIDOrder());
+        CHECK(q->toString() == "SELECT * FROM _ ORDER BY lastName, META().id");
+
+        q = N1QLClauses::parse("SELECT * FROM users AS u ORDER BY age DESC, meta(u).id DESC");
+        REQUIRE(q);
+        CHECK(q->addIDOrder());
+        CHECK(q->orderBy.size() == 2);
+
+        q = N1QLClauses::parse("SELECT * FROM _ ORDER BY META( ).id");
+        REQUIRE(q);
+        CHECK(q->addIDOrder());
+        CHECK(q->orderBy.size() == 1);
+
+        CHECK(!N1QLClauses::parse("SELECT name FROM _ GROUP BY name ORDER BY name")->addIDOrder());
+        CHECK(!N1QLClauses::parse("SELECT * FROM a JOIN b ON a.x = b.y ORDER BY a.z")->addIDOrder());
+    }
+
+    SECTION("Source") {
+        auto src = N1QLClauses::parseSource("_");
+        CHECK(src.scope == "_default");
+        CHECK(src.collection == "_default");
+        CHECK(src.alias == "_");
+        src = N1QLClauses::parseSource("inventory.hotels AS h JOIN x ON h.id = x.hid");
+        CHECK(src.scope == "inventory");
+        CHECK(src.collection == "hotels");
+        CHECK(src.alias == "h");
+        src = N1QLClauses::parseSource("users JOIN x ON users.id = x.uid");
+        CHECK(src.collection == "users");
+        CHECK(src.alias == "users");
+    }
+
+    SECTION("Keyset condition") {
+        auto q = N1QLClauses::parse("SELECT * FROM _ WHERE x = 1 ORDER BY name DESC, age");
+        REQUIRE(q);
+        q->addWhere(q->afterCondition("after_"));
+        CHECK(q->where == "(x = 1) AND "
+                          "((((name) < $after_0 OR (name) IS NOT VALUED)) OR "
+                          "((name) = $after_0 AND (age) > $after_1))");
+
+        // NULL or MISSING values in the cursor:
+        q = N1QLClauses::parse("SELECT * FROM _ ORDER BY name, age DESC, id");
+        REQUIRE(q);
+        CHECK(q->afterCondition("a", {true, true}) ==
+              "(((name) IS VALUED) OR "
+              "((name) IS NOT VALUED AND FALSE) OR "
+              "((name) IS NOT VALUED AND (age) IS NOT VALUED AND (id) > $a2))");
+    }
+
+    SECTION("Distinct") {
+        CHECK(N1QLClauses::parse("SELECT DISTINCT a FROM _")->isDistinct());
+        CHECK(N1QLClauses::parse("select distinct a FROM _")->isDistinct());
+        CHECK(!N1QLClauses::parse("SELECT a, distinct_count FROM _")->isDistinct());
+        CHECK(!N1QLClauses::parse("SELECT distinctive FROM _")->isDistinct());
+    }
+}
@@ -0,0 +1,95 @@
+//
+// QueryPlanTest.cc
+//
+// Copyright © 2026 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "TestsCommon.hh"
+#include "catch.hpp"
+#include "CatchHelper.hh"
+#include "QueryPlan.hh"
+using namespace std;
+using namespace fleece;
+
+static const char *kSQL =
+    "SELECT fl_result(_doc.key), fl_result(o.key) FROM \"kv_.store.users\" AS _doc "
+    "JOIN \"kv_.store.orders\" AS o ON fl_value(o.body, 'uid') = _doc.key "
+    "WHERE fl_value(_doc.body, 'age') > 21 ORDER BY fl_value(_doc.body, 'name')";
+
+TEST_CASE("Query Plan", "[cblite][QueryPlan]") {
+    SECTION("Table names (before SQLite 3.36)") {
+        string explanation = string(kSQL) + "\n\n"
+            "3|0|0| SCAN TABLE kv_.store.users AS _doc\n"
+            "5|0|0| SEARCH TABLE kv_.store.orders AS o USING INDEX byUID (<expr>=?)\n"
+            "9|0|0| USE TEMP B-TREE FOR ORDER BY\n"
+            "\n"
+            "{\"WHAT\":[]}\n";
+        QueryPlan plan = QueryPlan::parse(slice(explanation));
+        CHECK(plan.sql == kSQL);
+        REQUIRE(plan.steps.size() == 3);
+        CHECK(plan.steps[0].table == "kv_.store.users");
+        CHECK(plan.steps[0].fullScan);
+        CHECK(plan.steps[1].table == "kv_.store.orders");
+        CHECK(!plan.steps[1].fullScan);
+        CHECK(plan.steps[2].table.empty());
+        CHECK(plan.steps[2].tempBTree);
+        CHECK(plan.hasFullScan());
+    }
+
+    SECTION("Aliases (SQLite 3.36 and later)") {
+        string explanation = string(kSQL) + "\n\n"
+            "3|0|0|SCAN _doc\n"
+            "5|0|0|SEARCH o USING INDEX byUID (<expr>=?)\n"
+            "9|0|0|USE TEMP B-TREE FOR ORDER BY\n"
+            "\n"
+            "{\"WHAT\":[]}\n";
+        QueryPlan plan = QueryPlan::parse(slice(explanation));
+        REQUIRE(plan.steps.size() == 3);
+        CHECK(plan.steps[0].table == "kv_.store.users");
+        CHECK(plan.steps[0].fullScan);
+        CHECK(plan.steps[1].table == "kv_.store.orders");
+        CHECK(!plan.steps[1].fullScan);
+        CHECK(plan.hasFullScan());
+    }
+
+    SECTION("Index scans and FTS") {
+        string explanation =
+            "SELECT _doc.key FROM \"kv_default\" AS _doc "
+            "JOIN \"kv_default::byText\" AS fts1 ON fts1.docid = _doc.rowid\n"
+            "\n"
+            "2|0|0|SCAN _doc USING COVERING INDEX byName\n"
+            "4|0|0|SCAN fts1 VIRTUAL TABLE INDEX 0:M1\n"
+            "\n";
+        QueryPlan plan = QueryPlan::parse(slice(explanation));
+        REQUIRE(plan.steps.size() == 2);
+        CHECK(plan.steps[0].table == "kv_default");
+        CHECK(plan.steps[1].table == "kv_default::byText");
+        CHECK(!plan.hasFullScan());
+    }
+
+    SECTION("Collection for table") {
+        string scope, name;
+        auto spec = QueryPlan::collectionForTable("kv_.store.users", scope, name);
+        REQUIRE(spec);
+        CHECK(string(slice(spec->scope)) == "store");
+        CHECK(string(slice(spec->name)) == "users");
+        spec = QueryPlan::collectionForTable("kv_.users", scope, name);
+        REQUIRE(spec);
+        CHECK(string(slice(spec->scope)) == "_default");
+        CHECK(string(slice(spec->name)) == "users");
+        CHECK(QueryPlan::collectionForTable("kv_default", scope, name));
+        CHECK(!QueryPlan::collectionForTable("sqlite_master", scope, name));
+    }
+}